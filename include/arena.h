@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that live exactly as long as one compilation,
+// such as lexemes and AST nodes. Everything is released at once when the
+// arena is reset or destroyed; destructors only run for types that need them.
+class Arena {
+public:
+  explicit Arena(size_t block_size = 64 * 1024);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* Allocate(size_t size, size_t alignment);
+
+  template <typename T, typename... Args>
+  T* Create(Args&&... args) {
+    T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      finalizers_.push_back({[](void* p) { static_cast<T*>(p)->~T(); }, object});
+    }
+    return object;
+  }
+
+  // Destroys every object and keeps the first block for reuse.
+  void Reset();
+
+  size_t BytesUsed() const { return used_; }
+  size_t BytesReserved() const { return reserved_; }
+  size_t HighWaterMark() const { return high_water_mark_; }
+  size_t BlockCount() const { return blocks_.size(); }
+
+private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  struct Finalizer {
+    void (*destroy)(void*);
+    void* object;
+  };
+
+  void AddBlock(size_t min_size);
+
+  size_t block_size_;
+  std::vector<Block> blocks_;
+  std::vector<Finalizer> finalizers_;
+  char* cursor_ = nullptr;
+  char* limit_ = nullptr;
+  size_t used_ = 0;
+  size_t reserved_ = 0;
+  size_t high_water_mark_ = 0;
+};
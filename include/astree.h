@@ -1,43 +1,52 @@
 #pragma once
 
 #include <type_traits>
-#include <vector>
-#include <string>
+#include <string_view>
+#include "arena.h"
 
 template<class T>
 concept EnumType = std::is_enum_v<T>;
 
 static int sIdCounter = 0;
 
+// Tree nodes are allocated from the compilation's Arena and freed with it.
+// Children are kept as an intrusive sibling list so adding one never
+// allocates.
 template<EnumType Type, typename DataType>
 class ASTNode {
 public:
-  using SharedPtr = std::shared_ptr<ASTNode<Type, DataType>>;
-
-  ASTNode(Type type, DataType data, const std::string& name) : type_(type), data_(data), name_(name) {
+  ASTNode(Type type, DataType data, std::string_view name) : type_(type), data_(data), name_(name) {
     id_ = sIdCounter++;
   }
-  virtual ~ASTNode() {}
 
-  void AddChild(SharedPtr child) { childs_.push_back(child); }
-  void SetParent(SharedPtr parent) { parent_ = parent; }
-  SharedPtr GetParent() const { return parent_; }
-  std::vector<SharedPtr> GetChilds() { return childs_; }
+  void AddChild(ASTNode* child) {
+    child->parent_ = this;
+    if (last_child_ == nullptr) {
+      first_child_ = child;
+    } else {
+      last_child_->next_sibling_ = child;
+    }
+    last_child_ = child;
+  }
+  ASTNode* GetParent() const { return parent_; }
+  ASTNode* GetFirstChild() const { return first_child_; }
+  ASTNode* GetNextSibling() const { return next_sibling_; }
   int GetId() const { return id_; }
-  const std::string& GetName() const { return name_; }
+  std::string_view GetName() const { return name_; }
   Type GetType() const { return type_; }
-  DataType& GetData() const { return data_; }
+  DataType& GetData() { return data_; }
+  const DataType& GetData() const { return data_; }
 
-  static SharedPtr Create(Type type, DataType data, const std::string& name) {
-    return std::make_shared<ASTNode<Type, DataType>>(type, data, name);
+  static ASTNode* Create(Arena& arena, Type type, DataType data, std::string_view name) {
+    return arena.Create<ASTNode>(type, data, name);
   }
 private:
   int id_;
   Type type_;
   DataType data_;
-  std::string name_;
-  SharedPtr parent_;
-  std::vector<SharedPtr> childs_;
-
-
-};
\ No newline at end of file
+  std::string_view name_;
+  ASTNode* parent_ = nullptr;
+  ASTNode* first_child_ = nullptr;
+  ASTNode* last_child_ = nullptr;
+  ASTNode* next_sibling_ = nullptr;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "source_manager.h"
+
+// Lexes the file through Lexer::Next and Lexer::TokenizeAll and prints the
+// throughput of both paths in tokens per second.
+void BenchLexer(const SourceManager& sources, FileId file_id, int iterations);
+
+// Lexes the file with TokenizeParallel on one up to max_threads threads,
+// prints the speedup over one thread and checks that every run produces the
+// same tokens and diagnostics, in the same order, as Lexer::TokenizeAll.
+// Returns false if any run differs.
+bool BenchParallelLexer(const SourceManager& sources, FileId file_id, int iterations, unsigned max_threads);
+
+// Applies edit_count small edits spread over the file, then edit_count edits
+// close to each other, updates the tokens of every version with RelexEdit and
+// compares time and result with lexing the whole version again.
+void BenchIncrementalLexer(SourceManager& sources, FileId file_id, int edit_count);
+
+// Lexes and parses the file and prints the throughput in AST nodes per
+// second.
+void BenchParser(const SourceManager& sources, FileId file_id, int iterations);
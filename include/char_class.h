@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "utf8.h"
+
+enum CharClass : uint8_t {
+  CharClassEmpty = 1 << 0,
+  CharClassDigitType = 1 << 1,
+  CharClassIdentifierStart = 1 << 2,
+  CharClassIdentifierPart = 1 << 3,
+};
+
+// Classes of every byte value, built at compile time so classifying a
+// character is a single table lookup.
+constexpr std::array<uint8_t, 256> kCharClasses = [] {
+  std::array<uint8_t, 256> table{};
+  for (char c : std::string_view(" \t\n\r\v\f")) {
+    table[static_cast<unsigned char>(c)] |= CharClassEmpty;
+  }
+  for (char c : std::string_view("fFlL")) {
+    table[static_cast<unsigned char>(c)] |= CharClassDigitType;
+  }
+  for (int c = '0'; c <= '9'; ++c) {
+    table[c] |= CharClassIdentifierPart;
+  }
+  for (int c = 'a'; c <= 'z'; ++c) {
+    table[c] |= CharClassIdentifierStart | CharClassIdentifierPart;
+    table[c - 'a' + 'A'] |= CharClassIdentifierStart | CharClassIdentifierPart;
+  }
+  table['_'] |= CharClassIdentifierStart | CharClassIdentifierPart;
+  return table;
+}();
+
+inline bool HasCharClass(char c, uint8_t classes) {
+  return (kCharClasses[static_cast<unsigned char>(c)] & classes) != 0;
+}
+
+inline bool IsEmpty(char c) {
+  return HasCharClass(c, CharClassEmpty);
+}
+
+inline bool IsDigitType(char c) {
+  return HasCharClass(c, CharClassDigitType);
+}
+
+// Identifiers are [_a-zA-Z][_a-zA-Z0-9]{0,2048}, where letters and digits
+// may also be Unicode XID_Start and XID_Continue code points. The length
+// limit is in bytes.
+constexpr size_t kMaxIdentifierLength = 2049;
+
+inline bool IsIdentifier(std::string_view identifier) {
+  if (identifier.empty() || identifier.size() > kMaxIdentifierLength) {
+    return false;
+  }
+  // only identifiers with non-ASCII characters need decoding
+  if (!HasCharClass(identifier[0], CharClassIdentifierStart)) {
+    return static_cast<unsigned char>(identifier[0]) >= 0x80 && IsUnicodeIdentifier(identifier);
+  }
+  for (size_t i = 1; i < identifier.size(); ++i) {
+    if (!HasCharClass(identifier[i], CharClassIdentifierPart)) {
+      return static_cast<unsigned char>(identifier[i]) >= 0x80 && IsUnicodeIdentifier(identifier);
+    }
+  }
+  return true;
+}
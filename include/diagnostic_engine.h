@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "error_handler.h"
+#include "source_manager.h"
+
+// Collects diagnostics from several threads. Every thread reports into its
+// own buffer, so pushing an error never synchronizes, and Merge puts them
+// together in an order that does not depend on thread timing.
+class DiagnosticEngine {
+public:
+  DiagnosticEngine(const SourceManager& sources, size_t buffer_count);
+
+  // A buffer must only be used by one thread at a time.
+  ErrorHandler& Buffer(size_t index) {
+    return buffers_[index].errors;
+  }
+
+  // Pushes the errors of every buffer to error_handler ordered by file and
+  // offset. Errors at the same position come in buffer order, and the errors
+  // of one buffer keep their order.
+  void Merge(ErrorHandler& error_handler);
+private:
+  // on its own cache line so threads do not share one while pushing
+  struct alignas(64) Slot {
+    explicit Slot(const SourceManager& sources) : errors(sources) {
+    }
+
+    ErrorHandler errors;
+  };
+
+  std::vector<Slot> buffers_;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "error_handler.h"
+#include "source_manager.h"
+
+// Writes diagnostics one at a time through a fixed-size buffer, so memory
+// stays flat however many there are. JSON is written directly rather than
+// built up as a document first.
+class DiagnosticWriter {
+public:
+  DiagnosticWriter(const SourceManager& sources, DiagnosticFormat format, std::FILE* file);
+
+  DiagnosticWriter(const DiagnosticWriter&) = delete;
+  DiagnosticWriter& operator=(const DiagnosticWriter&) = delete;
+
+  void Write(const ErrorData& error);
+
+  // Ends the output and flushes it. limit_reached notes that the errors were
+  // cut off at the error limit.
+  void Finish(bool limit_reached);
+private:
+  // Returns the line the location is on. The line of the previous error is
+  // reused while the errors stay on it.
+  LineInfo ResolveLine(SourceLocation location);
+  // The message with its argument filled in, valid until the next call.
+  std::string_view FormatMessage(const ErrorData& error);
+  // Appends text as a quoted JSON string; bytes that are not UTF-8 become
+  // U+FFFD.
+  void AppendJsonString(std::string_view text);
+  // Appends a SARIF artifactLocation for the file. Absolute paths become file
+  // URIs, relative ones are relative to the working directory.
+  void AppendArtifactLocation(FileId file_id, std::string_view file_name);
+  void FlushIfFull();
+
+  const SourceManager& sources_;
+  DiagnosticFormat format_;
+  std::FILE* file_;
+  std::string buffer_;
+  std::string message_;
+  bool first_ = true;
+  // the line of the previous error, only for files that are in memory
+  FileId line_file_ = kInvalidFileId;
+  uint32_t line_start_ = 0;
+  LineInfo line_{};
+  // the artifactLocation of the previous error's file
+  FileId uri_file_ = kInvalidFileId;
+  std::string uri_;
+};
@@ -1,22 +1,100 @@
 #pragma once
 
-#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+#include "source_manager.h"
+
+// Diagnostics are kept as ids and only formatted when they are printed.
+enum DiagnosticId : uint8_t {
+  DiagnosticIdNone,
+  DiagnosticIdUnexpectedInvalidToken,
+  DiagnosticIdExpectedFunctionName,
+  DiagnosticIdExpectedLeftBrace,
+  DiagnosticIdExpectedStatement,
+  DiagnosticIdExpectedCloseParenthesis,
+  DiagnosticIdExpectedComma,
+  DiagnosticIdUnexpectedEndOfFile,
+  DiagnosticIdExpectedLeftParenthesis,
+  DiagnosticIdExpectedParameterType,
+  DiagnosticIdExpectedParameterName,
+  DiagnosticIdInvalidUnicodeEscape,
+  DiagnosticIdUnknownEscape,
+  DiagnosticIdInvalidUtf8,
+  DiagnosticIdUnterminatedComment,
+  DiagnosticIdInvalidFloatSuffix,
+  DiagnosticIdLeadingSeparator,
+  DiagnosticIdInt32TooLarge,
+  DiagnosticIdInt64TooLarge,
+  DiagnosticIdFloatOutOfRange,
+  DiagnosticIdDoubleOutOfRange,
+  DiagnosticIdInvalidNumber,
+  DiagnosticIdUnterminatedString,
+  DiagnosticIdEndOfLineInCharacter,
+  DiagnosticIdUnterminatedCharacter,
+  DiagnosticIdInvalidIdentifier,
+  DiagnosticIdExpectedExpression,
+  DiagnosticIdExpectedSemicolon,
+  DiagnosticIdExpectedVariableName,
+  DiagnosticIdExpectedTypeName,
+  DiagnosticIdExpectedMemberName,
+  DiagnosticIdInputTooLarge,
+  DiagnosticIdCount
+};
+
+// Stable name of a diagnostic for machine-readable output, such as
+// "invalid-utf8".
+std::string_view DiagnosticName(DiagnosticId id);
+// Message of a diagnostic, a {} in it is replaced with its argument.
+std::string_view DiagnosticMessage(DiagnosticId id);
+
+enum DiagnosticFormat {
+  DiagnosticFormatText,
+  // one JSON object per line
+  DiagnosticFormatJsonLines,
+  // a SARIF 2.1.0 log
+  DiagnosticFormatSarif
+};
 
 struct ErrorData {
-  std::string file;
-  std::string line;
-  int line_number;
-  int char_index;
-  std::string message;
+  SourceLocation location;
+  DiagnosticId id = DiagnosticIdNone;
+  uint8_t arg_size = 0;
+  // short text for the message, such as an escaped character
+  char arg[4] = {};
+
+  std::string_view Arg() const { return {arg, arg_size}; }
 };
+
 class ErrorHandler {
 public:
-  ErrorHandler();
+  ErrorHandler(const SourceManager& sources);
   ~ErrorHandler();
 
-  void PushError(std::string file, std::string line, int line_number, int char_index, std::string message);
+  // arg is cut to the size of ErrorData::arg. Errors past the limit are
+  // dropped.
+  void PushError(SourceLocation location, DiagnosticId id, std::string_view arg = {});
+  void PushError(const ErrorData& error);
 
-  bool PrintErrors();
+  // Keeps at most max_errors errors, 0 keeps all. The lexer, and with it the
+  // parser, stops once the limit is reached.
+  void SetMaxErrors(size_t max_errors) { max_errors_ = max_errors; }
+
+  bool LimitReached() const { return max_errors_ != 0 && errors_.size() >= max_errors_; }
+
+  const std::vector<ErrorData>& Errors() const { return errors_; }
+
+  // Drops every error after the first count.
+  void TruncateErrors(size_t count) { errors_.resize(count); }
+
+  // Drops the errors outside the bytes [first, last) of their file.
+  void KeepErrors(uint32_t first, uint32_t last);
+
+  // Writes every error to file. Returns whether there were any.
+  bool PrintErrors(DiagnosticFormat format = DiagnosticFormatText, std::FILE* file = stdout);
 private:
+  const SourceManager& sources_;
   std::vector<ErrorData> errors_;
-};
\ No newline at end of file
+  size_t max_errors_ = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fast non-cryptographic hash for short strings such as identifiers. Mixes
+// eight bytes at a time.
+inline uint64_t HashString(std::string_view str) {
+  constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+  const char* p = str.data();
+  size_t size = str.size();
+  uint64_t hash = size * kMultiplier;
+  while (size >= 8) {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 32;
+    p += 8;
+    size -= 8;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, p, size);
+  hash = (hash ^ tail) * kMultiplier;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+// XXH64 of a whole buffer, used to recognize file contents that were seen
+// before. Reads 32 bytes per round for large inputs.
+inline uint64_t HashBytes(std::string_view data, uint64_t seed = 0) {
+  constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+  constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+  constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+  constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+  constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+  auto rotate = [](uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); };
+  auto read64 = [](const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    return word;
+  };
+  auto round = [&](uint64_t acc, uint64_t input) { return rotate(acc + input * kPrime2, 31) * kPrime1; };
+  auto merge = [&](uint64_t acc, uint64_t lane) { return (acc ^ round(0, lane)) * kPrime1 + kPrime4; };
+
+  const char* p = data.data();
+  const char* end = p + data.size();
+  uint64_t hash;
+  if (data.size() >= 32) {
+    uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+    for (; end - p >= 32; p += 32) {
+      for (int i = 0; i < 4; ++i) {
+        lanes[i] = round(lanes[i], read64(p + i * 8));
+      }
+    }
+    hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) + rotate(lanes[2], 12) + rotate(lanes[3], 18);
+    for (uint64_t lane : lanes) {
+      hash = merge(hash, lane);
+    }
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += data.size();
+
+  for (; end - p >= 8; p += 8) {
+    hash = rotate(hash ^ round(0, read64(p)), 27) * kPrime1 + kPrime4;
+  }
+  if (end - p >= 4) {
+    uint32_t word;
+    std::memcpy(&word, p, 4);
+    hash = rotate(hash ^ (word * kPrime1), 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p != end; ++p) {
+    hash = rotate(hash ^ (static_cast<uint8_t>(*p) * kPrime5), 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "error_handler.h"
+#include "source_manager.h"
+#include "token_buffer.h"
+
+// Replacement of the removed bytes at offset with inserted.
+struct TextEdit {
+  uint32_t offset;
+  uint32_t removed;
+  std::string_view inserted;
+};
+
+std::string ApplyEdit(std::string_view text, const TextEdit& edit);
+
+// Updates the tokens and lexer errors of a file after an edit. file_id refers
+// to the edited text; tokens and errors hold the result of lexing the text
+// before the edit and are updated in place. Lexing restarts at the first
+// token the edit can change and stops as soon as a token starts where an old
+// token after the edit started; the tokens from there on are kept and only
+// their offsets move. The result is the same as that of Lexer::TokenizeAll on
+// the edited text with the default LexerOptions. Returns the number of tokens
+// that were lexed again.
+size_t RelexEdit(const SourceManager& sources, FileId file_id, const TextEdit& edit, TokenBuffer& tokens,
+                 std::vector<ErrorData>& errors);
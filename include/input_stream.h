@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+// Sequential reader for inputs that cannot be mapped or seeked, such as stdin
+// or a pipe. Only a window of the input is held in a fixed-size buffer; the
+// buffer only grows when a single token does not fit into it.
+class InputStream {
+public:
+  explicit InputStream(std::FILE* file, size_t capacity = 64 * 1024);
+
+  InputStream(const InputStream&) = delete;
+  InputStream& operator=(const InputStream&) = delete;
+
+  // The window holds the input bytes [Base(), Base() + Size()).
+  const char* Data() const { return buffer_.get(); }
+  size_t Size() const { return size_; }
+  uint32_t Base() const { return base_; }
+  size_t Capacity() const { return capacity_; }
+
+  // True once the whole input has been read into the window.
+  bool AtEnd() const { return at_end_; }
+  // True if the input goes on past the 4 GiB that source offsets can
+  // address. The window then ends there and AtEnd is true.
+  bool TooLarge() const { return too_large_; }
+
+  // Drops the bytes before keep, which points into the window, and reads
+  // more input behind the rest. Returns false if nothing could be read.
+  bool Refill(const char* keep);
+
+private:
+  std::FILE* file_;
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_;
+  size_t size_ = 0;
+  uint32_t base_ = 0;
+  bool at_end_ = false;
+  bool too_large_ = false;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+using Symbol = uint32_t;
+
+constexpr Symbol kNoSymbol = UINT32_MAX;
+
+struct InternerStats {
+  size_t unique_count = 0;
+  size_t bytes = 0;
+  size_t lookups = 0;
+  size_t hits = 0;
+
+  double HitRate() const {
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+  }
+};
+
+// Maps strings to stable 32-bit symbols so identifiers and literals can be
+// compared and hashed as integers. Interning is thread-safe: the table is
+// split into shards by hash, each with its own lock, open-addressing table
+// and arena for the string bytes, and each thread keeps a small cache of
+// recent symbols that is checked without locking. Lookups and hits are
+// counted per thread as well, so a cache hit touches no shared memory.
+// Interned strings never move, so views returned by Lookup stay valid for the
+// lifetime of the interner.
+class Interner {
+public:
+  Interner();
+  ~Interner();
+
+  Interner(const Interner&) = delete;
+  Interner& operator=(const Interner&) = delete;
+
+  static Interner& Global();
+
+  Symbol Intern(std::string_view str);
+  std::string_view Lookup(Symbol symbol) const;
+
+  InternerStats Stats() const;
+
+private:
+  static constexpr int kShardBits = 4;
+  static constexpr size_t kShardCount = size_t{1} << kShardBits;
+  // block i holds 2^(kFirstBlockBits + i) strings
+  static constexpr int kFirstBlockBits = 8;
+  static constexpr size_t kMaxBlocks = 32 - kShardBits - kFirstBlockBits + 1;
+  static constexpr size_t kArenaChunkSize = 64 * 1024;
+
+  // Written only by the thread they belong to, read by Stats. Each sits on
+  // its own cache line.
+  struct alignas(64) ThreadCounters {
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> hits{0};
+  };
+
+  struct Slot {
+    uint32_t hash;
+    // index of the string in the shard plus one, zero for an empty slot
+    uint32_t entry;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::vector<Slot> slots;
+    uint32_t count = 0;
+    // strings are stored in blocks of doubling size that are never
+    // reallocated, so Lookup can read them without taking the lock
+    std::array<std::atomic<std::string_view*>, kMaxBlocks> blocks{};
+    std::vector<std::unique_ptr<char[]>> arena;
+    char* arena_cursor = nullptr;
+    size_t arena_remaining = 0;
+    size_t bytes = 0;
+  };
+
+  // The calling thread's counters, registered on its first use.
+  ThreadCounters& Counters();
+  std::string_view Store(Shard& shard, std::string_view str);
+  void Grow(Shard& shard);
+
+  uint64_t generation_;
+  std::unique_ptr<Shard[]> shards_;
+  // kept after their thread exits so Stats still includes them
+  mutable std::mutex counters_mutex_;
+  std::vector<std::shared_ptr<ThreadCounters>> counters_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+enum KeywordType : uint8_t {
+  KeywordTypeNone,
+  KeywordTypeIf,
+  KeywordTypeElse,
+  KeywordTypeWhile,
+  KeywordTypeFor,
+  KeywordTypeReturn,
+  KeywordTypeBreak,
+  KeywordTypeContinue,
+  KeywordTypeTrue,
+  KeywordTypeFalse,
+  KeywordTypeNull,
+  KeywordTypeFun,
+  KeywordTypeEnum,
+  KeywordTypeClass,
+  KeywordTypeImport,
+  KeywordTypeVar,
+  KeywordTypeModule,
+  KeywordTypeExtern,
+  KeywordTypeStatic,
+  KeywordTypeCount,
+};
+
+constexpr std::array<std::string_view, KeywordTypeCount> kKeywordNames = {
+    "", "if", "else", "while", "for", "return", "break", "continue", "true",
+    "false", "null", "fun", "enum", "class", "import", "var", "module", "extern",
+    "static",
+};
+
+constexpr size_t kMinKeywordLength = 2;
+constexpr size_t kMaxKeywordLength = 8;
+constexpr int kKeywordHashBits = 6;
+
+constexpr uint32_t KeywordKey(std::string_view str) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(str[0])) << 24 |
+         static_cast<uint32_t>(static_cast<uint8_t>(str[1])) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(str.back())) << 8 |
+         static_cast<uint32_t>(str.size());
+}
+
+constexpr uint32_t KeywordSlot(std::string_view str, uint32_t seed) {
+  return (KeywordKey(str) * seed) >> (32 - kKeywordHashBits);
+}
+
+// Multiplier for which every keyword hashes to its own slot, searched for at
+// compile time so adding a keyword only means extending the lists above.
+constexpr uint32_t kKeywordHashSeed = [] {
+  for (uint32_t seed = 1;; ++seed) {
+    uint64_t used = 0;
+    bool collision = false;
+    for (size_t i = 1; i < kKeywordNames.size() && !collision; ++i) {
+      uint64_t bit = uint64_t{1} << KeywordSlot(kKeywordNames[i], seed);
+      collision = (used & bit) != 0;
+      used |= bit;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+}();
+
+constexpr std::array<KeywordType, 1 << kKeywordHashBits> kKeywordTable = [] {
+  std::array<KeywordType, 1 << kKeywordHashBits> table{};
+  for (size_t i = 1; i < kKeywordNames.size(); ++i) {
+    table[KeywordSlot(kKeywordNames[i], kKeywordHashSeed)] = static_cast<KeywordType>(i);
+  }
+  return table;
+}();
+
+// Maps a word to its keyword with one hash and at most one comparison.
+constexpr KeywordType LookupKeyword(std::string_view str) {
+  if (str.size() < kMinKeywordLength || str.size() > kMaxKeywordLength) {
+    return KeywordTypeNone;
+  }
+  KeywordType keyword = kKeywordTable[KeywordSlot(str, kKeywordHashSeed)];
+  return kKeywordNames[keyword] == str ? keyword : KeywordTypeNone;
+}
+
+static_assert(LookupKeyword("continue") == KeywordTypeContinue);
+static_assert(LookupKeyword("fun") == KeywordTypeFun);
+static_assert(LookupKeyword("fn") == KeywordTypeNone);
@@ -3,44 +3,20 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <sstream>
-#include <regex>
+#include <unordered_map>
+#include <memory>
+#include "char_class.h"
+#include "arena.h"
 #include "error_handler.h"
+#include "input_stream.h"
+#include "interner.h"
+#include "keyword.h"
+#include "source_manager.h"
+#include "token_dfa.h"
 
-inline bool IsEmpty(char c) {
-  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f' || c == EOF;
-}
-
-inline bool IsOperator(char c) {
-  return c == '=' || c == '+' || c == '-' || c == '*' || c == '/' || c == '%' || c == '^' || c == '!' || c == '<' || c == '>' || c == '&' || c == '|' || c == '~' || c == '?';
-}
-
-inline bool IsKeyword(const std::string& str) {
-  return str == "if" || str == "else" || str == "while" || str == "for" || str == "return" ||
-  str == "break" || str == "continue" || str == "true" || str == "false" || str == "null" ||
-  str == "fun" || str == "enum" || str == "class" || str == "import" || str == "var" ||
-  str == "module" || str == "extern" || str == "static";
-}
-
-inline bool IsPunctuation(char c) {
-  return c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':' || c == ';' || c == '.';
-}
-
-inline bool IsDigit(char c) {
-  return c >= '0' && c <= '9';
-}
-
-const std::regex kIdentifierPattern("[_a-zA-Z][_a-zA-Z0-9]{0,2048}");
-
-inline bool IsDigitType(char c) {
-  return c == 'f' || c == 'F' || c == 'l' || c == 'L';
-}
-
-inline bool IsIdentifier(const std::string& identifier) {
-  return std::regex_match(identifier, kIdentifierPattern);
-}
-
-enum TokenType {
+enum TokenType : uint8_t {
   TokenTypeIdentifier,
   TokenTypeKeyword,
   TokenTypeOperator,
@@ -79,63 +55,222 @@ inline bool IsTokenConstant(TokenType token) {
     return token == TokenTypeCharacterLiteral || token == TokenTypeStringLiteral || token == TokenTypeNumberDouble || token == TokenTypeNumberFloat || token == TokenTypeNumberInt32 || token == TokenTypeNumberInt64 || token == TokenTypeBoolean;
 }
 
+inline bool IsTokenNumber(TokenType token) {
+  return token == TokenTypeNumberDouble || token == TokenTypeNumberFloat || token == TokenTypeNumberInt32 || token == TokenTypeNumberInt64;
+}
+
+// Binary value of a token. Which member is set depends on the token type:
+// numbers carry their converted value, identifiers and literals their symbol.
+union TokenPayload {
+  Symbol symbol;
+  int32_t int32;
+  int64_t int64;
+  float float32;
+  double float64;
+  uint64_t bits;
+};
+
+// What the lexer does with comments.
+enum CommentMode : uint8_t {
+  // return them as TokenTypeComment tokens
+  CommentModeToken,
+  // attach the range they cover to the token following them
+  CommentModeTrivia,
+  // skip them
+  CommentModeDrop
+};
+
+struct LexerOptions {
+  CommentMode comments = CommentModeToken;
+};
+
+// The value is a view into the source buffer owned by the SourceManager, so a
+// Lexeme must not outlive it. String and character literals with escape
+// sequences are the exception: their value is the decoded text, owned by the
+// interner.
 class Lexeme {
 public:
-  Lexeme(const std::string& file, const std::string& value, TokenType type, const std::string& line, int line_number, int char_index)
-      : file_(file),
-        value_(value),
+  Lexeme() = default;
+  Lexeme(std::string_view value, TokenType type, SourceLocation location, KeywordType keyword = KeywordTypeNone, Symbol symbol = kNoSymbol)
+      : value_(value),
+        type_(type),
+        keyword_(keyword),
+        location_(location) {
+    payload_.bits = 0;
+    payload_.symbol = symbol;
+  }
+  Lexeme(std::string_view value, TokenType type, SourceLocation location, TokenPayload payload)
+      : value_(value),
         type_(type),
-        line_(line),
-        line_number_(line_number),
-        char_index_(char_index) {}
+        location_(location),
+        payload_(payload) {}
+  Lexeme(std::string_view value, TokenType type, SourceLocation location, OperatorId op)
+      : value_(value),
+        type_(type),
+        operator_(op),
+        location_(location) {}
 
-  const std::string& Value() const {
+  std::string_view Value() const {
     return value_;
   }
 
+  void SetValue(std::string_view value) {
+    value_ = value;
+  }
+
   TokenType Type() const {
     return type_;
   }
 
-  int LineNumber() const {
-    return line_number_;
+  KeywordType Keyword() const {
+    return keyword_;
   }
 
-  int CharIndex() const {
-    return char_index_;
+  // Which operator or punctuation the token is.
+  OperatorId Operator() const {
+    return operator_;
   }
 
-  const std::string& Line() const {
-    return line_;
+  // Interned value of identifiers and string and character literals.
+  Symbol GetSymbol() const {
+    return IsTokenNumber(type_) ? kNoSymbol : payload_.symbol;
   }
 
-  const std::string& File() const {
-    return file_;
+  // Converted value of number tokens.
+  const TokenPayload& Payload() const {
+    return payload_;
   }
-private:
-  std::string file_;
-  std::string value_;
-  TokenType type_;
-  std::string line_;
 
-  int line_number_;
-  int char_index_;
+  SourceLocation Location() const {
+    return location_;
+  }
+
+  // Source range of the comments right before the token, from the start of
+  // the first to the end of the last. Only set with CommentModeTrivia; the
+  // text is never copied, tools that want it read it from the source.
+  SourceRange Trivia() const {
+    return trivia_;
+  }
 
+  void SetTrivia(SourceRange trivia) {
+    trivia_ = trivia;
+  }
+private:
+  std::string_view value_;
+  TokenType type_ = TokenTypeInvalid;
+  KeywordType keyword_ = KeywordTypeNone;
+  OperatorId operator_ = OperatorIdNone;
+  SourceLocation location_;
+  TokenPayload payload_ = {.symbol = kNoSymbol};
+  SourceRange trivia_;
 };
 
+class TokenBuffer;
+
 class Lexer {
 public:
-  Lexer(std::string file, std::stringstream& source, ErrorHandler& error_handler);
+  Lexer(const SourceManager& sources, FileId file_id, Arena& arena, ErrorHandler& error_handler,
+        LexerOptions options = {});
+
+  // Lexes a file registered with SourceManager::AddStream from input, keeping
+  // only the input's window in memory. Lexeme values never point into the
+  // window: they are interned once the token is complete, or taken from the
+  // keyword and operator names. Only Next is supported on streamed input.
+  Lexer(InputStream& input, SourceManager& sources, FileId file_id, Arena& arena, ErrorHandler& error_handler,
+        LexerOptions options = {});
+
+  // Hands out the tokens of a buffer lexed earlier, for example one loaded
+  // from the token cache, without scanning the source. The errors lexing
+  // produced are pushed when the token they belong to is handed out. Only
+  // Next is supported when replaying.
+  Lexer(const TokenBuffer& tokens, const std::vector<ErrorData>& errors, Arena& arena, ErrorHandler& error_handler,
+        LexerOptions options = {});
+
+  // The lexeme is allocated from the arena and lives as long as it does.
+  Lexeme* Next();
 
-  std::shared_ptr<Lexeme> Next();
+  // Returns the next token by value with the comment mode applied, for
+  // callers that keep their own storage such as LookaheadBuffer. Its value
+  // lives as long as the arena.
+  Lexeme Lex();
 
-  void UpdateLine();
+  // Lexes the remaining input into tokens without allocating per token. The
+  // end of file token is included.
+  void TokenizeAll(TokenBuffer& tokens);
+
+  // Appends the next token to tokens. Returns false once the end of file
+  // token has been appended.
+  bool TokenizeNext(TokenBuffer& tokens);
+
+  // Lexes the tokens that start before end_offset; the last one may extend
+  // past it. Returns true if the end of file was reached.
+  bool TokenizeUntil(TokenBuffer& tokens, uint32_t end_offset);
+
+  // Continues lexing at the given byte offset. Tokens carry no state between
+  // each other, so any token start is a valid restart point.
+  void Seek(uint32_t offset) {
+    cursor_ = begin_ + (offset - base_);
+    utf8_checked_ = offset;
+    utf8_invalid_ = false;
+  }
+
+  uint32_t Offset() const {
+    return base_ + static_cast<uint32_t>(cursor_ - begin_);
+  }
 private:
-  std::string file_;
-  std::stringstream& source_;
+  // Ends the input early once the error handler's limit is reached.
+  Lexeme Stop();
+  // Scans the next token and reports malformed UTF-8 in it.
+  Lexeme Scan();
+  Lexeme ScanToken();
+  Lexeme ScanStream();
+  Lexeme Replay();
+  void Refill(const char* keep);
+  void CheckUtf8();
+  // Returns the value of a literal with escape sequences, which is valid
+  // until the next call.
+  std::string_view DecodeEscapes(std::string_view text);
+  // Interns the value of an identifier or literal, unless the token is cut
+  // off and lexed again later.
+  Symbol Intern(std::string_view value);
+
+  // True if a streamed token runs into the end of the window and may continue
+  // past it.
+  bool CutOff() const {
+    return input_ != nullptr && cursor_ == end_ && !input_->AtEnd();
+  }
+
+  SourceLocation Location(const char* c) const {
+    return {file_id_, base_ + static_cast<uint32_t>(c - begin_)};
+  }
+
+  FileId file_id_;
+  LexerOptions options_;
+  const char* begin_;
+  const char* cursor_;
+  const char* end_;
+  // offset of begin_ in the file
+  uint32_t base_ = 0;
+  InputStream* input_ = nullptr;
+  const TokenBuffer* replay_ = nullptr;
+  size_t replay_index_ = 0;
+  const std::vector<ErrorData>* replay_errors_ = nullptr;
+  size_t replay_error_index_ = 0;
+  SourceManager* stream_sources_ = nullptr;
+  // line number and start offset of the line begin_ is on, and the number of
+  // its code points before begin_
+  int window_line_ = 1;
+  uint32_t window_line_start_ = 0;
+  int window_line_columns_ = 0;
+  // the input went on past the last addressable offset
+  bool too_large_reported_ = false;
+  // Input is validated as UTF-8 in blocks ahead of the cursor, up to this
+  // offset. If utf8_invalid_ is set, the sequence there is malformed and is
+  // reported once a token reaches it.
+  uint32_t utf8_checked_ = 0;
+  bool utf8_invalid_ = false;
+  std::string escape_buffer_;
+  Arena& arena_;
   ErrorHandler& error_handler_;
-  std::string line_;
-  int line_number_;
-  int char_index_;
+  Interner& interner_;
 };
-
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include "lexer.h"
+
+// Ring of the tokens after the parser's current one, so it can look up to
+// Capacity tokens ahead. Tokens are kept by value, filling and consuming never
+// allocate.
+template <size_t Capacity>
+class LookaheadBuffer {
+  static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+public:
+  explicit LookaheadBuffer(Lexer& lexer) : lexer_(lexer) {
+  }
+
+  // Returns the token k positions ahead without consuming it; Peek(0) is the
+  // one Next returns next. Past the end of file it keeps returning the end of
+  // file token.
+  const Lexeme& Peek(size_t k) {
+    assert(k < Capacity);
+    while (count_ <= k) {
+      ring_[(head_ + count_) & kMask] = lexer_.Lex();
+      count_++;
+    }
+    return ring_[(head_ + k) & kMask];
+  }
+
+  Lexeme Next() {
+    if (count_ == 0) {
+      return lexer_.Lex();
+    }
+    Lexeme lexeme = ring_[head_];
+    head_ = (head_ + 1) & kMask;
+    count_--;
+    return lexeme;
+  }
+private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  Lexer& lexer_;
+  std::array<Lexeme, Capacity> ring_;
+  size_t head_ = 0;
+  size_t count_ = 0;
+};
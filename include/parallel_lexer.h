@@ -0,0 +1,16 @@
+#pragma once
+
+#include "error_handler.h"
+#include "source_manager.h"
+#include "token_buffer.h"
+
+// Tokenizes a file on up to thread_count threads. The buffer is split into
+// chunks at line starts and every chunk is lexed speculatively on its own
+// thread. Where a token of one chunk runs into the next (an unterminated or
+// multi-line comment, say), the next chunk is re-lexed from the real token
+// boundary until it lines up with its speculative tokens again. Tokens and
+// errors come out exactly as Lexer::TokenizeAll with the default
+// LexerOptions would produce them, also when error_handler has an error
+// limit: the chunks are then lexed in full and the tokens after the one that
+// reached the limit are dropped.
+void TokenizeParallel(const SourceManager& sources, FileId file_id, ErrorHandler& error_handler, TokenBuffer& tokens, unsigned thread_count);
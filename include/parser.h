@@ -2,6 +2,7 @@
 
 #include <string>
 #include "lexer.h"
+#include "lookahead_buffer.h"
 #include "error_handler.h"
 #include "astree.h"
 #include "grammar.h"
@@ -22,47 +23,102 @@ enum class ParseType {
   BooleanLiteral,
   ImplicitCastExpr,
   BinaryOperator,
-  UnaryOperator
+  UnaryOperator,
+  NullLiteral,
+  DeclRefExpr,
+  MemberExpr,
+  CallExpr,
+  ReturnStatement
 };
 
+std::string_view ParseTypeName(ParseType type);
+
 struct ParseData {
-  std::string value_;
-  std::string line_;
-  int line_number_;
-  int char_index_;
+  std::string_view value_;
+  // declared type of ParamVarDecl and VarDecl nodes
+  std::string_view type_;
+  SourceLocation location_;
 };
 
+// Builds the tree in a single pass over the tokens, looking at most a few
+// tokens ahead. Nodes and their values live as long as the arena.
 class Parser {
 public:
   using ParseNode = ASTNode<ParseType, ParseData>;
-  Parser(const std::string& file, Lexer& lexer, ErrorHandler& error_handler);
+  Parser(FileId file_id, Lexer& lexer, Arena& arena, ErrorHandler& error_handler);
   ~Parser();
 
-  std::shared_ptr<ParseNode> Parse();
-
-  void ParseFunction();
-  void ParseStatement();
-  void ParseParameters();
+  ParseNode* Parse();
 
-  std::shared_ptr<Lexeme> Next() {
-    return current_lexeme_ = lexer_.Next();
+  size_t NodeCount() const {
+    return node_count_;
   }
-  bool CheckPunctuation(const std::string& value);
-  bool CheckPunctuation(std::shared_ptr<Lexeme> lexeme, const std::string& value);
 
+  // The parse functions start at the current token and leave the last token
+  // they used current. They return nullptr when nothing could be parsed.
+  ParseNode* ParseFunction();
+  // Adds the parameters to function; false if the list is malformed.
+  bool ParseParameters(ParseNode* function);
+  ParseNode* ParseCompoundStatement();
+  ParseNode* ParseStatement();
+  ParseNode* ParseVarDeclaration();
+  ParseNode* ParseTypedDeclaration();
+  ParseNode* ParseReturn();
+  // Pratt parser over the binding powers of the operators. Parses the
+  // expression whose operators bind at least min_power tightly.
+  ParseNode* ParseExpression(int min_power = 0);
+  // Calls, member accesses and postfix increments, which bind tightest.
+  ParseNode* ParsePostfix();
+  ParseNode* ParsePrimary();
+
+  const Lexeme& Next() {
+    return current_lexeme_ = tokens_.Next();
+  }
+  // The token k positions after the current one; Peek(0) is the next.
+  const Lexeme& Peek(size_t k) {
+    return tokens_.Peek(k);
+  }
+  // Consumes the next token if it is the given punctuation.
+  bool Accept(OperatorId id);
+  bool CheckPunctuation(OperatorId id);
+  bool CheckPunctuation(const Lexeme& lexeme, OperatorId id);
+  // Reports the first error of a recovery region; the ones after it are
+  // follow-on errors and dropped until the parser is back in sync at the end
+  // of a statement or the start of a function.
+  void ReportError(SourceLocation location, DiagnosticId id);
 
 private:
-  std::shared_ptr<ParseNode> root_;
-  std::shared_ptr<ParseNode> current_node_;
+  ParseNode* CreateNode(ParseType type, std::string_view value, SourceLocation location);
+  ParseNode* CreateNode(ParseType type, const Lexeme& lexeme) {
+    return CreateNode(type, lexeme.Value(), lexeme.Location());
+  }
+  // Adds the initializer and semicolon of a declaration and wraps it into a
+  // DeclStatement.
+  ParseNode* FinishDeclaration(ParseNode* var);
+  // Consumes the semicolon after a statement, or reports it missing and
+  // skips the rest of the statement.
+  bool ExpectSemicolon();
+  // Skips to the statement's semicolon, stopping early before a right brace
+  // or the end of file.
+  void SkipStatement();
+
+  ParseNode* root_;
+  size_t node_count_ = 0;
 
-  std::string file_;
-  Lexer& lexer_;
+  FileId file_id_;
+  LookaheadBuffer<8> tokens_;
+  Arena& arena_;
   ErrorHandler& error_handler_;
-  std::shared_ptr<Lexeme> current_lexeme_;
+  Lexeme current_lexeme_;
+  bool recovering_ = false;
   std::shared_ptr<Grammar> grammar_;
   // module_name, vector<symbol_name>
-  std::unordered_map<std::string, std::vector<std::string>> symbol_table;
+  std::unordered_map<Symbol, std::vector<Symbol>> symbol_table;
 
 
 
-};
\ No newline at end of file
+};
+
+// Appends an outline of the tree to out, one node per line indented by its
+// depth.
+void DumpTree(const Parser::ParseNode* node, std::string& out, int depth = 0);
@@ -0,0 +1,42 @@
+#pragma once
+
+// Vectorized scanning loops used by the lexer. Every kernel returns the first
+// byte in [p, end) that ends the run it skips over, or end. The best
+// implementation for the running CPU (AVX2, SSE2 or scalar) is picked once at
+// startup.
+struct ScanKernels {
+  const char* name;
+  // ' ', '\t', '\n', '\v', '\f' and '\r'
+  const char* (*skip_whitespace)(const char* p, const char* end);
+  // returns the '\n'
+  const char* (*find_newline)(const char* p, const char* end);
+  // returns the '*' of the next "*/"
+  const char* (*find_comment_end)(const char* p, const char* end);
+  // returns the next '"', '\\' or '\n'
+  const char* (*find_string_end)(const char* p, const char* end);
+  // returns the first byte of the first malformed or cut off UTF-8 sequence;
+  // p must be at the start of a sequence
+  const char* (*find_invalid_utf8)(const char* p, const char* end);
+};
+
+extern const ScanKernels& kScanKernels;
+
+inline const char* SkipWhitespace(const char* p, const char* end) {
+  return kScanKernels.skip_whitespace(p, end);
+}
+
+inline const char* FindNewline(const char* p, const char* end) {
+  return kScanKernels.find_newline(p, end);
+}
+
+inline const char* FindCommentEnd(const char* p, const char* end) {
+  return kScanKernels.find_comment_end(p, end);
+}
+
+inline const char* FindStringEnd(const char* p, const char* end) {
+  return kScanKernels.find_string_end(p, end);
+}
+
+inline const char* FindInvalidUtf8(const char* p, const char* end) {
+  return kScanKernels.find_invalid_utf8(p, end);
+}
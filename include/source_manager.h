@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_file.h"
+
+using FileId = uint32_t;
+
+constexpr FileId kInvalidFileId = UINT32_MAX;
+
+// Position of a byte in a buffer owned by a SourceManager. Line and column are
+// only computed from it when a diagnostic is printed.
+struct SourceLocation {
+  FileId file_id = kInvalidFileId;
+  uint32_t offset = 0;
+};
+
+// Bytes [offset, offset + length) of a file.
+struct SourceRange {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+};
+
+// Line and columns are 1-based. char_index counts code points, byte_index
+// bytes.
+struct LineInfo {
+  int line_number;
+  int char_index;
+  int byte_index;
+  std::string_view line;
+  // Code points of the line missing in front of line. Only streamed input
+  // whose line did not fit in memory loses its start.
+  int skipped_columns = 0;
+};
+
+// Owns every source buffer of a compilation together with the offsets of its
+// line starts, so tokens and diagnostics only need a SourceLocation.
+class SourceManager {
+public:
+  SourceManager();
+  ~SourceManager();
+
+  // Returns kInvalidFileId if the file could not be read.
+  FileId AddFile(const std::string& path);
+  FileId AddBuffer(const std::string& name, std::string contents);
+
+  // Registers an input that is read through an InputStream. Its buffer stays
+  // empty; the lexer reports the part that is in memory with SetStreamWindow.
+  FileId AddStream(const std::string& name);
+  // line_number and line_start describe the line the window begins on, and
+  // line_columns is the number of its code points before the window.
+  void SetStreamWindow(FileId file_id, std::string_view window, uint32_t base, int line_number, uint32_t line_start,
+                       int line_columns);
+
+  // Keeps a copy of the line a diagnostic points into while it is still in
+  // a streamed file's window. Does nothing for other files.
+  void NoteLine(SourceLocation location) const;
+
+  const std::string& FileName(FileId file_id) const {
+    return files_[file_id]->name;
+  }
+
+  std::string_view Buffer(FileId file_id) const {
+    return files_[file_id]->data;
+  }
+
+  bool IsStreamed(FileId file_id) const {
+    return files_[file_id]->streamed;
+  }
+
+  LineInfo GetLineInfo(SourceLocation location) const;
+
+  // Offsets of the first byte of every line. The table is built on first use,
+  // which must not race with other calls for the same file.
+  const std::vector<uint32_t>& LineStarts(FileId file_id) const;
+  // Installs a table built earlier for the same contents, such as one loaded
+  // from the token cache.
+  void SetLineStarts(FileId file_id, std::vector<uint32_t> line_starts);
+
+private:
+  struct LineNote {
+    uint32_t offset;
+    int line_number;
+    int char_index;
+    int byte_index;
+    std::string line;
+    // offset following the copied text, which is incomplete while open
+    uint32_t line_end;
+    bool open;
+    int skipped_columns;
+  };
+
+  struct StreamWindow {
+    std::string_view data;
+    uint32_t base = 0;
+    int line_number = 1;
+    uint32_t line_start = 0;
+    int line_columns = 0;
+  };
+
+  struct Entry {
+    std::string name;
+    MappedFile file;
+    std::string contents;
+    std::string_view data;
+    mutable std::vector<uint32_t> line_starts;
+    bool streamed = false;
+    StreamWindow window;
+    // sorted by offset; only filled while diagnostics are pushed, which
+    // happens on the thread lexing the stream
+    mutable std::vector<LineNote> line_notes;
+  };
+
+  FileId AddEntry(std::unique_ptr<Entry> entry);
+
+  std::vector<std::unique_ptr<Entry>> files_;
+};
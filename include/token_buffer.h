@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "interner.h"
+#include "lexer.h"
+#include "source_manager.h"
+
+// Tokens of one file in struct-of-arrays layout, as produced by
+// Lexer::TokenizeAll. Offset and length cover the token's source text. The
+// value ids of identifiers and literals are their symbols in the global
+// Interner, those of numbers index the buffer's constant pool. Other tokens
+// have no value id and their value is the source text.
+//
+// Splice leaves a gap in the arrays where it replaced tokens. The offsets of
+// the tokens behind the gap are kept relative to a shared base, so an edit
+// only moves the base, and the next Splice only moves the tokens between the
+// two edits. Appending closes the gap again.
+class TokenBuffer {
+public:
+  void Clear();
+  // Drops every token after the first count.
+  void Truncate(size_t count);
+  void Reserve(size_t count);
+
+  // Appends tokens [first, last) of other, which must come from the same
+  // source.
+  void Append(const TokenBuffer& other, size_t first, size_t last);
+
+  // Replaces tokens [first, last) with every token of replacement and moves
+  // the offsets of the tokens behind them by shift. Constants of replaced
+  // numbers stay in the pool. Costs the size of the replacement plus the
+  // number of tokens between first and the previous Splice; trivia entries
+  // are rewritten in full.
+  void Splice(size_t first, size_t last, const TokenBuffer& replacement, int64_t shift);
+
+  void Push(TokenType type, uint32_t offset, uint32_t length, Symbol value_id) {
+    if (gap_begin_ != kNoGap) {
+      CloseGap();
+    }
+    types_.push_back(type);
+    offsets_.push_back(offset);
+    lengths_.push_back(length);
+    value_ids_.push_back(value_id);
+  }
+
+  // Attaches a trivia range to the token pushed next.
+  void PushTrivia(SourceRange range) {
+    trivia_.push_back({static_cast<uint32_t>(Size()), range});
+  }
+
+  // Comments in front of token i with CommentModeTrivia, see Lexeme::Trivia.
+  SourceRange Trivia(size_t i) const;
+
+  size_t Size() const { return types_.size() - gap_size_; }
+  FileId GetFileId() const { return file_id_; }
+  std::string_view Source() const { return source_; }
+
+  void SetSource(FileId file_id, std::string_view source) {
+    file_id_ = file_id;
+    source_ = source;
+  }
+
+  TokenType Type(size_t i) const { return static_cast<TokenType>(types_[Slot(i)]); }
+  uint32_t Offset(size_t i) const { return i < gap_begin_ ? offsets_[i] : offsets_[i + gap_size_] + tail_base_; }
+  uint32_t Length(size_t i) const { return lengths_[Slot(i)]; }
+  Symbol ValueId(size_t i) const { return value_ids_[Slot(i)]; }
+  SourceLocation Location(size_t i) const { return {file_id_, Offset(i)}; }
+
+  uint32_t AddConstant(TokenPayload value) {
+    constants_.push_back(value.bits);
+    return static_cast<uint32_t>(constants_.size() - 1);
+  }
+
+  TokenPayload Number(size_t i) const {
+    TokenPayload payload;
+    payload.bits = constants_[ValueId(i)];
+    return payload;
+  }
+
+  std::string_view Value(size_t i) const {
+    Symbol id = ValueId(i);
+    if (id == kNoSymbol || IsTokenNumber(Type(i))) {
+      return source_.substr(Offset(i), Length(i));
+    }
+    return Interner::Global().Lookup(id);
+  }
+
+  const std::vector<uint64_t>& Constants() const { return constants_; }
+
+private:
+  static constexpr size_t kNoGap = SIZE_MAX;
+
+  size_t Slot(size_t i) const { return i < gap_begin_ ? i : i + gap_size_; }
+  // Moves the gap in front of token position, opening one if there is none.
+  void MoveGap(size_t position);
+  // Makes room for at least count tokens in the gap.
+  void GrowGap(size_t count);
+  void CloseGap();
+
+  // Few tokens have comments in front of them, so trivia is kept aside
+  // instead of in a fifth array.
+  struct TriviaEntry {
+    uint32_t token;
+    SourceRange range;
+  };
+
+  FileId file_id_ = kInvalidFileId;
+  std::string_view source_;
+  std::vector<uint8_t> types_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> lengths_;
+  std::vector<Symbol> value_ids_;
+  std::vector<uint64_t> constants_;
+  // Tokens from gap_begin_ on sit gap_size_ slots further back, their stored
+  // offsets are relative to tail_base_.
+  size_t gap_begin_ = kNoGap;
+  size_t gap_size_ = 0;
+  uint32_t tail_base_ = 0;
+  // sorted by token
+  std::vector<TriviaEntry> trivia_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+#include "error_handler.h"
+#include "source_manager.h"
+#include "token_buffer.h"
+
+// On-disk cache of lexer results keyed by the XXH64 hash of a file's
+// contents. An entry holds the token arrays of a TokenBuffer, the strings its
+// symbols refer to, the lexer's errors and the file's line table in one
+// binary file that is mapped back in on a hit.
+class TokenCache {
+public:
+  explicit TokenCache(std::filesystem::path directory);
+
+  // Lexes the file unless the cache holds its tokens and stores the result
+  // on a miss.
+  void Tokenize(SourceManager& sources, FileId file_id, TokenBuffer& tokens, std::vector<ErrorData>& errors);
+
+  // Returns false if there is no valid entry for the file's contents.
+  bool Load(SourceManager& sources, FileId file_id, TokenBuffer& tokens, std::vector<ErrorData>& errors);
+  // Returns false if the entry could not be written.
+  bool Store(const SourceManager& sources, FileId file_id, const TokenBuffer& tokens,
+             const std::vector<ErrorData>& errors);
+
+  size_t Hits() const { return hits_; }
+  size_t Misses() const { return misses_; }
+
+private:
+  std::filesystem::path EntryPath(uint64_t source_hash) const;
+
+  std::filesystem::path directory_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+inline bool IsUtf8Continuation(char c) {
+  return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// Decodes the UTF-8 sequence at p. Returns its length, or 0 if it is
+// malformed (overlong, a surrogate, above U+10FFFF) or cut off by end.
+inline int DecodeUtf8(const char* p, const char* end, char32_t& code_point) {
+  auto byte = [&](int i) { return static_cast<unsigned char>(p[i]); };
+  unsigned char lead = byte(0);
+  if (lead < 0x80) {
+    code_point = lead;
+    return 1;
+  }
+  int length;
+  // bounds of the second byte, which rule out overlong forms, surrogates
+  // and code points above U+10FFFF
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+    code_point = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    code_point = lead & 0x0F;
+    low = lead == 0xE0 ? 0xA0 : 0x80;
+    high = lead == 0xED ? 0x9F : 0xBF;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    code_point = lead & 0x07;
+    low = lead == 0xF0 ? 0x90 : 0x80;
+    high = lead == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+  if (end - p < length || byte(1) < low || byte(1) > high) {
+    return 0;
+  }
+  for (int i = 1; i < length; ++i) {
+    if (!IsUtf8Continuation(p[i])) {
+      return 0;
+    }
+    code_point = (code_point << 6) | (byte(i) & 0x3F);
+  }
+  return length;
+}
+
+// Writes the encoding of a code point that is not a surrogate and at most
+// U+10FFFF to out, which must have room for four bytes. Returns its length.
+inline int EncodeUtf8(char32_t code_point, char* out) {
+  if (code_point < 0x80) {
+    out[0] = static_cast<char>(code_point);
+    return 1;
+  }
+  if (code_point < 0x800) {
+    out[0] = static_cast<char>(0xC0 | (code_point >> 6));
+    out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 2;
+  }
+  if (code_point < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | (code_point >> 12));
+    out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | (code_point >> 18));
+  out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+  out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+  out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+  return 4;
+}
+
+// Whether [p, end) is the start of a well-formed sequence that is cut off by
+// end.
+inline bool IsCutOffUtf8(const char* p, const char* end) {
+  unsigned char lead = static_cast<unsigned char>(p[0]);
+  int length = lead >= 0xC2 && lead <= 0xDF ? 2 : lead >= 0xE0 && lead <= 0xEF ? 3 : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+  if (end - p >= length) {
+    return false;
+  }
+  // complete it with continuation bytes and see whether it decodes
+  char sequence[4] = {p[0], '\x80', '\x80', '\x80'};
+  for (int i = 1; i < end - p; ++i) {
+    sequence[i] = p[i];
+  }
+  if (end - p == 1) {
+    return true;
+  }
+  char32_t code_point;
+  return DecodeUtf8(sequence, sequence + length, code_point) == length;
+}
+
+// Number of code points in valid UTF-8 text.
+inline size_t CountCodePoints(std::string_view text) {
+  size_t count = 0;
+  for (char c : text) {
+    count += !IsUtf8Continuation(c);
+  }
+  return count;
+}
+
+// Unicode identifier properties (UAX #31) of code points above ASCII.
+bool IsXidStart(char32_t code_point);
+bool IsXidContinue(char32_t code_point);
+
+// Checks an identifier that contains non-ASCII bytes: a letter or _ followed
+// by letters, digits and _, where letters and digits are XID_Start and
+// XID_Continue code points.
+bool IsUnicodeIdentifier(std::string_view identifier);
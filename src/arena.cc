@@ -0,0 +1,49 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {
+}
+
+Arena::~Arena() {
+  Reset();
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  auto address = reinterpret_cast<uintptr_t>(cursor_);
+  size_t padding = (alignment - address % alignment) % alignment;
+  if (cursor_ == nullptr || size + padding > static_cast<size_t>(limit_ - cursor_)) {
+    AddBlock(size + alignment);
+    address = reinterpret_cast<uintptr_t>(cursor_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+  char* result = cursor_ + padding;
+  cursor_ = result + size;
+  used_ += size + padding;
+  high_water_mark_ = std::max(high_water_mark_, used_);
+  return result;
+}
+
+void Arena::Reset() {
+  for (auto it = finalizers_.rbegin(); it != finalizers_.rend(); ++it) {
+    it->destroy(it->object);
+  }
+  finalizers_.clear();
+  if (blocks_.size() > 1) {
+    blocks_.erase(blocks_.begin() + 1, blocks_.end());
+  }
+  reserved_ = blocks_.empty() ? 0 : blocks_[0].size;
+  cursor_ = blocks_.empty() ? nullptr : blocks_[0].data.get();
+  limit_ = blocks_.empty() ? nullptr : cursor_ + blocks_[0].size;
+  used_ = 0;
+}
+
+void Arena::AddBlock(size_t min_size) {
+  // grow geometrically so large compilations need few blocks
+  size_t size = std::max({block_size_, min_size, reserved_});
+  blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+  reserved_ += size;
+  cursor_ = blocks_.back().data.get();
+  limit_ = cursor_ + size;
+}
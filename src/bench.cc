@@ -0,0 +1,206 @@
+#include "bench.h"
+
+#include <chrono>
+#include <iostream>
+#include "arena.h"
+#include "error_handler.h"
+#include "incremental_lexer.h"
+#include "interner.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "parser.h"
+#include "simd_scan.h"
+#include "token_buffer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void Report(const std::string& name, size_t count, size_t bytes, Clock::duration elapsed,
+            std::string_view unit = "tokens") {
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << name << ": " << count << " " << unit << " in " << seconds * 1000.0 << " ms, "
+            << count / seconds / 1e6 << " M" << unit << "/s, "
+            << bytes / seconds / (1024.0 * 1024.0) << " MiB/s" << std::endl;
+}
+
+bool SameErrors(const std::vector<ErrorData>& a, const std::vector<ErrorData>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].location.file_id != b[i].location.file_id || a[i].location.offset != b[i].location.offset ||
+        a[i].id != b[i].id || a[i].Arg() != b[i].Arg()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameTokens(const TokenBuffer& a, const TokenBuffer& b) {
+  if (a.Size() != b.Size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.Size(); ++i) {
+    if (a.Type(i) != b.Type(i) || a.Offset(i) != b.Offset(i) || a.Length(i) != b.Length(i) ||
+        a.Value(i) != b.Value(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void BenchLexer(const SourceManager& sources, FileId file_id, int iterations) {
+  size_t bytes = sources.Buffer(file_id).size() * iterations;
+  std::cout << "scan kernels: " << kScanKernels.name << std::endl;
+
+  size_t tokens = 0;
+  auto start = Clock::now();
+  Arena arena;
+  for (int i = 0; i < iterations; ++i) {
+    ErrorHandler error_handler{sources};
+    Lexer lexer{sources, file_id, arena, error_handler};
+    while (lexer.Next()->Type() != TokenTypeEndOfFile) {
+      tokens++;
+    }
+    arena.Reset();
+  }
+  Report("Lexer::Next", tokens, bytes, Clock::now() - start);
+
+  tokens = 0;
+  TokenBuffer buffer;
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    ErrorHandler error_handler{sources};
+    Lexer lexer{sources, file_id, arena, error_handler};
+    buffer.Clear();
+    lexer.TokenizeAll(buffer);
+    tokens += buffer.Size() - 1;
+  }
+  Report("Lexer::TokenizeAll", tokens, bytes, Clock::now() - start);
+
+  InternerStats interner = Interner::Global().Stats();
+  std::cout << "interner: " << interner.unique_count << " unique strings, "
+            << interner.bytes << " bytes, " << interner.HitRate() * 100.0 << "% hit rate" << std::endl;
+}
+
+bool BenchParallelLexer(const SourceManager& sources, FileId file_id, int iterations, unsigned max_threads) {
+  size_t bytes = sources.Buffer(file_id).size() * iterations;
+  TokenBuffer expected;
+  std::vector<ErrorData> expected_errors;
+  {
+    ErrorHandler error_handler{sources};
+    Arena arena;
+    Lexer lexer{sources, file_id, arena, error_handler};
+    lexer.TokenizeAll(expected);
+    expected_errors = error_handler.Errors();
+  }
+
+  bool all_same = true;
+  double base_seconds = 0;
+  TokenBuffer buffer;
+  for (unsigned threads = 1; threads <= max_threads; ++threads) {
+    bool same_tokens = true;
+    bool same_errors = true;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      ErrorHandler error_handler{sources};
+      buffer.Clear();
+      TokenizeParallel(sources, file_id, error_handler, buffer, threads);
+      same_tokens = same_tokens && SameTokens(expected, buffer);
+      // the merged diagnostics must come out in the serial lexer's order
+      same_errors = same_errors && SameErrors(expected_errors, error_handler.Errors());
+    }
+    auto elapsed = Clock::now() - start;
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    if (threads == 1) {
+      base_seconds = seconds;
+    }
+    Report("TokenizeParallel x" + std::to_string(threads), (expected.Size() - 1) * iterations, bytes, elapsed);
+    std::cout << "  speedup " << base_seconds / seconds << (same_tokens ? "" : ", tokens differ from TokenizeAll")
+              << (same_errors ? "" : ", diagnostics differ from TokenizeAll") << std::endl;
+    all_same = all_same && same_tokens && same_errors;
+  }
+  return all_same;
+}
+
+void BenchIncrementalLexer(SourceManager& sources, FileId file_id, int edit_count) {
+  static constexpr std::string_view kInsertions[] = {"x", " ", "\n", "/*", "*/", "\"", "1'0", "fun ", "// ", ";"};
+  Arena arena;
+  TokenBuffer tokens;
+  std::vector<ErrorData> errors;
+  {
+    ErrorHandler error_handler{sources};
+    Lexer lexer{sources, file_id, arena, error_handler};
+    lexer.TokenizeAll(tokens);
+    errors = error_handler.Errors();
+  }
+
+  // Splice moves the tokens between the previous edit and this one, so edits
+  // spread over the file cost up to the size of the file while edits close to
+  // each other, as in typing, cost the size of the edit.
+  uint64_t seed = 88172645463325252ull;
+  auto run = [&](std::string_view name, bool nearby) {
+    size_t relexed = 0;
+    bool same = true;
+    Clock::duration incremental{};
+    Clock::duration full{};
+    uint32_t cursor = static_cast<uint32_t>(sources.Buffer(file_id).size() / 2);
+    for (int i = 0; i < edit_count; ++i) {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      std::string_view text = sources.Buffer(file_id);
+      TextEdit edit;
+      if (nearby) {
+        cursor = static_cast<uint32_t>(std::min<uint64_t>(cursor + seed % 64, text.size()));
+        edit.offset = cursor;
+      } else {
+        edit.offset = static_cast<uint32_t>(seed % (text.size() + 1));
+      }
+      edit.removed = static_cast<uint32_t>(std::min<size_t>(seed >> 32 & 3, text.size() - edit.offset));
+      edit.inserted = kInsertions[(seed >> 40) % std::size(kInsertions)];
+      file_id = sources.AddBuffer(sources.FileName(file_id), ApplyEdit(text, edit));
+
+      auto start = Clock::now();
+      relexed += RelexEdit(sources, file_id, edit, tokens, errors);
+      incremental += Clock::now() - start;
+
+      TokenBuffer expected;
+      ErrorHandler expected_errors{sources};
+      start = Clock::now();
+      Lexer lexer{sources, file_id, arena, expected_errors};
+      lexer.TokenizeAll(expected);
+      full += Clock::now() - start;
+      same = same && SameTokens(expected, tokens) && SameErrors(expected_errors.Errors(), errors);
+      arena.Reset();
+    }
+
+    double incremental_ms = std::chrono::duration<double, std::milli>(incremental).count() / edit_count;
+    double full_ms = std::chrono::duration<double, std::milli>(full).count() / edit_count;
+    std::cout << "RelexEdit, " << name << ": " << edit_count << " edits, "
+              << static_cast<double>(relexed) / edit_count << " tokens lexed per edit, " << incremental_ms
+              << " ms per edit vs " << full_ms << " ms for a full lex"
+              << (same ? "" : ", tokens differ from TokenizeAll") << std::endl;
+  };
+  run("edits anywhere (cost up to O(tokens in file))", false);
+  run("nearby edits (cost O(edit))", true);
+}
+
+void BenchParser(const SourceManager& sources, FileId file_id, int iterations) {
+  size_t bytes = sources.Buffer(file_id).size() * iterations;
+  size_t nodes = 0;
+  Arena arena;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    ErrorHandler error_handler{sources};
+    Lexer lexer{sources, file_id, arena, error_handler, {.comments = CommentModeDrop}};
+    Parser parser{file_id, lexer, arena, error_handler};
+    parser.Parse();
+    nodes += parser.NodeCount();
+    arena.Reset();
+  }
+  Report("Parser", nodes, bytes, Clock::now() - start, "nodes");
+}
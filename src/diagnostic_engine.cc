@@ -0,0 +1,38 @@
+#include "diagnostic_engine.h"
+
+DiagnosticEngine::DiagnosticEngine(const SourceManager& sources, size_t buffer_count) {
+  buffers_.reserve(buffer_count);
+  for (size_t i = 0; i < buffer_count; ++i) {
+    buffers_.emplace_back(sources);
+  }
+}
+
+void DiagnosticEngine::Merge(ErrorHandler& error_handler) {
+  // a k-way merge of the buffers' heads; there is a buffer per thread, so a
+  // linear scan for the smallest is enough
+  std::vector<size_t> heads(buffers_.size(), 0);
+  while (true) {
+    const ErrorData* next = nullptr;
+    size_t next_buffer = 0;
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      const std::vector<ErrorData>& errors = buffers_[i].errors.Errors();
+      if (heads[i] == errors.size()) {
+        continue;
+      }
+      const ErrorData& error = errors[heads[i]];
+      if (next == nullptr || error.location.file_id < next->location.file_id ||
+          (error.location.file_id == next->location.file_id && error.location.offset < next->location.offset)) {
+        next = &error;
+        next_buffer = i;
+      }
+    }
+    if (next == nullptr) {
+      break;
+    }
+    error_handler.PushError(*next);
+    heads[next_buffer]++;
+  }
+  for (Slot& slot : buffers_) {
+    slot.errors.TruncateErrors(0);
+  }
+}
@@ -0,0 +1,265 @@
+#include "diagnostic_writer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include "utf8.h"
+
+namespace {
+
+constexpr size_t kBufferSize = 64 * 1024;
+
+constexpr std::string_view kLimitMessage = "too many errors emitted, stopping now";
+
+constexpr std::string_view kSourceRoot = "%SRCROOT%";
+
+// Appends path as a URI path, percent-encoding every byte outside the
+// unreserved set. ':' is encoded too, a relative reference may not have one
+// in its first segment.
+void AppendUriPath(std::string& out, std::string_view path) {
+  static constexpr char kHex[] = "0123456789ABCDEF";
+  for (char ch : path) {
+    unsigned char c = static_cast<unsigned char>(ch);
+    bool unreserved = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+                      c == '.' || c == '_' || c == '~' || c == '/';
+    if (unreserved) {
+      out += ch;
+    } else {
+      out += '%';
+      out += kHex[c >> 4];
+      out += kHex[c & 0xF];
+    }
+  }
+}
+
+}  // namespace
+
+DiagnosticWriter::DiagnosticWriter(const SourceManager& sources, DiagnosticFormat format, std::FILE* file)
+    : sources_(sources),
+      format_(format),
+      file_(file) {
+  buffer_.reserve(kBufferSize + 1024);
+  if (format_ == DiagnosticFormatSarif) {
+    buffer_ +=
+        "{\"version\":\"2.1.0\","
+        "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+        "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"sono\"}},";
+    // relative file names are resolved against the working directory
+    std::error_code error;
+    std::filesystem::path root = std::filesystem::current_path(error);
+    if (!error) {
+      buffer_ += "\"originalUriBaseIds\":{\"";
+      buffer_ += kSourceRoot;
+      buffer_ += "\":{\"uri\":\"file://";
+      std::string root_path = root.generic_string();
+      AppendUriPath(buffer_, root_path);
+      if (!root_path.ends_with('/')) {
+        buffer_ += '/';
+      }
+      buffer_ += "\"}},";
+    }
+    buffer_ += "\"columnKind\":\"unicodeCodePoints\",\"results\":[";
+  }
+}
+
+void DiagnosticWriter::Write(const ErrorData& error) {
+  SourceLocation location = error.location;
+  LineInfo info = ResolveLine(location);
+  const std::string& file_name = sources_.FileName(location.file_id);
+  switch (format_) {
+    case DiagnosticFormatText:
+      buffer_ += file_name;
+      buffer_ += ':';
+      buffer_ += std::to_string(info.line_number);
+      buffer_ += ':';
+      buffer_ += std::to_string(info.char_index);
+      buffer_ += ": error: ";
+      buffer_ += FormatMessage(error);
+      buffer_ += '\n';
+      buffer_ += info.line;
+      buffer_ += '\n';
+      buffer_.append(std::max(info.char_index - 1 - info.skipped_columns, 0), ' ');
+      buffer_ += "^\n";
+      break;
+    case DiagnosticFormatJsonLines:
+      buffer_ += "{\"file\":";
+      AppendJsonString(file_name);
+      buffer_ += ",\"line\":";
+      buffer_ += std::to_string(info.line_number);
+      buffer_ += ",\"column\":";
+      buffer_ += std::to_string(info.char_index);
+      buffer_ += ",\"offset\":";
+      buffer_ += std::to_string(location.offset);
+      buffer_ += ",\"severity\":\"error\",\"code\":";
+      AppendJsonString(DiagnosticName(error.id));
+      buffer_ += ",\"message\":";
+      AppendJsonString(FormatMessage(error));
+      buffer_ += "}\n";
+      break;
+    case DiagnosticFormatSarif:
+      if (!first_) {
+        buffer_ += ',';
+      }
+      buffer_ += "{\"ruleId\":";
+      AppendJsonString(DiagnosticName(error.id));
+      buffer_ += ",\"level\":\"error\",\"message\":{\"text\":";
+      AppendJsonString(FormatMessage(error));
+      buffer_ += "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":";
+      AppendArtifactLocation(location.file_id, file_name);
+      buffer_ += ",\"region\":{";
+      if (info.line_number != 0) {
+        buffer_ += "\"startLine\":";
+        buffer_ += std::to_string(info.line_number);
+        buffer_ += ",\"startColumn\":";
+        buffer_ += std::to_string(info.char_index);
+        buffer_ += ',';
+      }
+      buffer_ += "\"byteOffset\":";
+      buffer_ += std::to_string(location.offset);
+      buffer_ += ",\"snippet\":{\"text\":";
+      AppendJsonString(info.line);
+      buffer_ += "}}}}]}";
+      break;
+  }
+  first_ = false;
+  FlushIfFull();
+}
+
+void DiagnosticWriter::Finish(bool limit_reached) {
+  switch (format_) {
+    case DiagnosticFormatText:
+      if (limit_reached) {
+        buffer_ += "error: ";
+        buffer_ += kLimitMessage;
+        buffer_ += '\n';
+      }
+      break;
+    case DiagnosticFormatJsonLines:
+      if (limit_reached) {
+        buffer_ += "{\"severity\":\"fatal\",\"code\":\"too-many-errors\",\"message\":\"";
+        buffer_ += kLimitMessage;
+        buffer_ += "\"}\n";
+      }
+      break;
+    case DiagnosticFormatSarif:
+      buffer_ += "],\"invocations\":[{\"executionSuccessful\":";
+      buffer_ += limit_reached ? "false" : "true";
+      if (limit_reached) {
+        buffer_ += ",\"toolExecutionNotifications\":[{\"level\":\"error\",\"message\":{\"text\":\"";
+        buffer_ += kLimitMessage;
+        buffer_ += "\"}}]";
+      }
+      buffer_ += "}]}]}\n";
+      break;
+  }
+  std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+  buffer_.clear();
+  std::fflush(file_);
+}
+
+LineInfo DiagnosticWriter::ResolveLine(SourceLocation location) {
+  if (location.file_id == line_file_ && location.offset >= line_start_ &&
+      location.offset - line_start_ <= line_.line.size()) {
+    LineInfo info = line_;
+    std::string_view before = line_.line.substr(0, location.offset - line_start_);
+    info.char_index = static_cast<int>(CountCodePoints(before)) + 1;
+    info.byte_index = static_cast<int>(before.size()) + 1;
+    return info;
+  }
+  LineInfo info = sources_.GetLineInfo(location);
+  // a streamed file's note may only hold part of the line
+  if (!sources_.IsStreamed(location.file_id) && info.line_number != 0) {
+    line_file_ = location.file_id;
+    line_start_ = location.offset - (info.byte_index - 1);
+    line_ = info;
+  }
+  return info;
+}
+
+std::string_view DiagnosticWriter::FormatMessage(const ErrorData& error) {
+  std::string_view message = DiagnosticMessage(error.id);
+  size_t placeholder = message.find("{}");
+  if (placeholder == std::string_view::npos) {
+    return message;
+  }
+  message_.assign(message.substr(0, placeholder));
+  message_ += error.Arg();
+  message_ += message.substr(placeholder + 2);
+  return message_;
+}
+
+void DiagnosticWriter::AppendArtifactLocation(FileId file_id, std::string_view file_name) {
+  if (file_id != uri_file_) {
+    uri_file_ = file_id;
+    uri_.clear();
+    std::filesystem::path path{file_name};
+    if (path.is_absolute()) {
+      uri_ += "{\"uri\":\"file://";
+      AppendUriPath(uri_, path.generic_string());
+      uri_ += "\"}";
+    } else {
+      uri_ += "{\"uri\":\"";
+      AppendUriPath(uri_, path.generic_string());
+      uri_ += "\",\"uriBaseId\":\"";
+      uri_ += kSourceRoot;
+      uri_ += "\"}";
+    }
+  }
+  buffer_ += uri_;
+}
+
+void DiagnosticWriter::AppendJsonString(std::string_view text) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  buffer_ += '"';
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p != end) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c >= 0x80) {
+      char32_t code_point;
+      int length = DecodeUtf8(p, end, code_point);
+      if (length == 0) {
+        buffer_ += "\\ufffd";
+        p++;
+      } else {
+        buffer_.append(p, length);
+        p += length;
+      }
+      continue;
+    }
+    switch (c) {
+      case '"':
+        buffer_ += "\\\"";
+        break;
+      case '\\':
+        buffer_ += "\\\\";
+        break;
+      case '\n':
+        buffer_ += "\\n";
+        break;
+      case '\r':
+        buffer_ += "\\r";
+        break;
+      case '\t':
+        buffer_ += "\\t";
+        break;
+      default:
+        if (c < 0x20 || c == 0x7F) {
+          buffer_ += "\\u00";
+          buffer_ += kHex[c >> 4];
+          buffer_ += kHex[c & 0xF];
+        } else {
+          buffer_ += static_cast<char>(c);
+        }
+        break;
+    }
+    p++;
+  }
+  buffer_ += '"';
+}
+
+void DiagnosticWriter::FlushIfFull() {
+  if (buffer_.size() >= kBufferSize) {
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    buffer_.clear();
+  }
+}
@@ -1,29 +1,99 @@
 #include "error_handler.h"
 
-ErrorHandler::ErrorHandler() {
+#include <algorithm>
+#include <cstring>
+#include "diagnostic_writer.h"
+
+namespace {
+
+struct DiagnosticInfo {
+  std::string_view name;
+  std::string_view message;
+};
+
+constexpr DiagnosticInfo kDiagnostics[] = {
+    {"", ""},
+    {"unexpected-invalid-token", "unexpected invalid token"},
+    {"expected-function-name", "expected function name"},
+    {"expected-left-brace", "expected left brace"},
+    {"expected-statement", "expected statement"},
+    {"expected-close-parenthesis", "expected close parenthesis"},
+    {"expected-comma", "expected comma"},
+    {"unexpected-end-of-file", "unexpected end of file"},
+    {"expected-left-parenthesis", "expected left parenthesis"},
+    {"expected-parameter-type", "expected parameter type"},
+    {"expected-parameter-name", "expected parameter name"},
+    {"invalid-unicode-escape", "Invalid Unicode escape sequence"},
+    {"unknown-escape", "Unknown escape sequence '\\{}'"},
+    {"invalid-utf8", "Invalid UTF-8 sequence"},
+    {"unterminated-comment", "Unterminated comment"},
+    {"invalid-float-suffix", "Invalid suffix '.'character in floating constant"},
+    {"leading-separator", "Leading separators are not allowed"},
+    {"int32-too-large", "Integer constant is too large for Int32"},
+    {"int64-too-large", "Integer constant is too large for Int64"},
+    {"float-out-of-range", "Floating constant is out of range for Float"},
+    {"double-out-of-range", "Floating constant is out of range for Double"},
+    {"invalid-number", "Invalid numeric constant"},
+    {"unterminated-string", "Unterminated string literal"},
+    {"end-of-line-in-character", "Unexpected end of line in character constant"},
+    {"unterminated-character", "Unterminated character constant"},
+    {"invalid-identifier", "Invalid identifier name"},
+    {"expected-expression", "expected expression"},
+    {"expected-semicolon", "expected semicolon"},
+    {"expected-variable-name", "expected variable name"},
+    {"expected-type-name", "expected type name"},
+    {"expected-member-name", "expected member name"},
+    {"input-too-large", "Input is larger than 4 GiB, the rest is ignored"},
+};
+static_assert(std::size(kDiagnostics) == DiagnosticIdCount);
+
+}  // namespace
+
+std::string_view DiagnosticName(DiagnosticId id) {
+  return kDiagnostics[id].name;
+}
+
+std::string_view DiagnosticMessage(DiagnosticId id) {
+  return kDiagnostics[id].message;
+}
+
+ErrorHandler::ErrorHandler(const SourceManager& sources) : sources_(sources) {
 }
 
 ErrorHandler::~ErrorHandler() {
 }
 
-void ErrorHandler::PushError(std::string file, std::string line, int line_number, int char_index, std::string message) {
+void ErrorHandler::PushError(SourceLocation location, DiagnosticId id, std::string_view arg) {
+  if (LimitReached()) {
+    return;
+  }
   ErrorData error;
-  error.file = file;
-  error.line = line;
-  error.line_number = line_number;
-  error.char_index = char_index;
-  error.message = message;
+  error.location = location;
+  error.id = id;
+  error.arg_size = static_cast<uint8_t>(std::min(arg.size(), sizeof(error.arg)));
+  std::memcpy(error.arg, arg.data(), error.arg_size);
+  errors_.push_back(error);
+  sources_.NoteLine(location);
+}
+
+void ErrorHandler::PushError(const ErrorData& error) {
+  if (LimitReached()) {
+    return;
+  }
   errors_.push_back(error);
 }
 
-bool ErrorHandler::PrintErrors() {
-  for (int i = 0; i < errors_.size(); i++) {
-    std::cout << errors_[i].file << ":" << errors_[i].line_number << ":" << errors_[i].char_index << ": error: " << errors_[i].message << std::endl;
-    std::cout << errors_[i].line << std::endl;
-    for (int j = 0; j < errors_[i].char_index - 1; j++) {
-      std::cout << " ";
-    }
-    std::cout << "^" << std::endl;
+void ErrorHandler::KeepErrors(uint32_t first, uint32_t last) {
+  std::erase_if(errors_, [&](const ErrorData& error) {
+    return error.location.offset < first || error.location.offset >= last;
+  });
+}
+
+bool ErrorHandler::PrintErrors(DiagnosticFormat format, std::FILE* file) {
+  DiagnosticWriter writer{sources_, format, file};
+  for (const ErrorData& error : errors_) {
+    writer.Write(error);
   }
+  writer.Finish(LimitReached());
   return errors_.size() > 0;
 }
@@ -0,0 +1,92 @@
+#include "incremental_lexer.h"
+
+#include <algorithm>
+#include "arena.h"
+#include "lexer.h"
+
+std::string ApplyEdit(std::string_view text, const TextEdit& edit) {
+  std::string result;
+  result.reserve(text.size() - edit.removed + edit.inserted.size());
+  result.append(text.substr(0, edit.offset));
+  result.append(edit.inserted);
+  result.append(text.substr(edit.offset + edit.removed));
+  return result;
+}
+
+size_t RelexEdit(const SourceManager& sources, FileId file_id, const TextEdit& edit, TokenBuffer& tokens,
+                 std::vector<ErrorData>& errors) {
+  const int64_t shift = static_cast<int64_t>(edit.inserted.size()) - edit.removed;
+  // first byte after the edit in the new text
+  const uint32_t edit_end = edit.offset + static_cast<uint32_t>(edit.inserted.size());
+
+  // A token decides where it ends by looking at the byte following it, so
+  // every token that ends at or after the edit may change.
+  size_t first = 0;
+  size_t count = tokens.Size();
+  while (count > 0) {
+    size_t half = count / 2;
+    size_t middle = first + half;
+    if (tokens.Offset(middle) + tokens.Length(middle) < edit.offset) {
+      first = middle + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  uint32_t restart = first == 0 ? 0 : tokens.Offset(first - 1) + tokens.Length(first - 1);
+
+  ErrorHandler relex_errors{sources};
+  Arena arena;
+  Lexer lexer{sources, file_id, arena, relex_errors};
+  lexer.Seek(restart);
+  TokenBuffer relexed;
+  size_t last = first;
+  bool synced = false;
+  bool more = true;
+  while (more && !synced) {
+    more = lexer.TokenizeNext(relexed);
+    uint32_t start = relexed.Offset(relexed.Size() - 1);
+    if (start < edit_end) {
+      continue;
+    }
+    // the text from start on is unchanged, so is every token from here
+    int64_t old_start = start - shift;
+    while (last < tokens.Size() && tokens.Offset(last) < old_start) {
+      last++;
+    }
+    synced = last < tokens.Size() && tokens.Offset(last) == old_start;
+  }
+
+  // old_sync and new_sync are where the streams met, in the old and new text
+  uint32_t old_sync = UINT32_MAX;
+  uint32_t new_sync = UINT32_MAX;
+  if (synced) {
+    // that token is already in tokens
+    new_sync = relexed.Offset(relexed.Size() - 1);
+    old_sync = tokens.Offset(last);
+    relexed.Truncate(relexed.Size() - 1);
+  }
+
+  auto erase_begin = std::find_if(errors.begin(), errors.end(),
+                                  [&](const ErrorData& error) { return error.location.offset >= restart; });
+  auto erase_end = std::find_if(erase_begin, errors.end(),
+                                [&](const ErrorData& error) { return error.location.offset >= old_sync; });
+  for (auto it = erase_end; it != errors.end(); ++it) {
+    it->location = {file_id, static_cast<uint32_t>(it->location.offset + shift)};
+  }
+  for (auto it = errors.begin(); it != erase_begin; ++it) {
+    it->location.file_id = file_id;
+  }
+  std::vector<ErrorData> inserted;
+  for (const ErrorData& error : relex_errors.Errors()) {
+    if (error.location.offset < new_sync) {
+      inserted.push_back(error);
+    }
+  }
+  auto position = errors.erase(erase_begin, erase_end);
+  errors.insert(position, inserted.begin(), inserted.end());
+
+  tokens.Splice(first, last, relexed, shift);
+  tokens.SetSource(file_id, sources.Buffer(file_id));
+  return relexed.Size();
+}
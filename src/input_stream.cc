@@ -0,0 +1,40 @@
+#include "input_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+InputStream::InputStream(std::FILE* file, size_t capacity)
+    : file_(file), buffer_(new char[capacity]), capacity_(capacity) {
+}
+
+bool InputStream::Refill(const char* keep) {
+  size_t dropped = keep - buffer_.get();
+  size_t kept = size_ - dropped;
+  if (kept == capacity_) {
+    // a single token fills the whole buffer
+    capacity_ *= 2;
+    std::unique_ptr<char[]> buffer(new char[capacity_]);
+    std::memcpy(buffer.get(), keep, kept);
+    buffer_ = std::move(buffer);
+  } else if (dropped != 0) {
+    std::memmove(buffer_.get(), keep, kept);
+  }
+  base_ += static_cast<uint32_t>(dropped);
+  size_ = kept;
+  if (at_end_) {
+    return false;
+  }
+  size_t requested = capacity_ - size_;
+  // offsets are 32 bits wide, nothing past the last one is read
+  size_t addressable = UINT32_MAX - base_ - size_;
+  bool limited = requested >= addressable;
+  requested = std::min(requested, addressable);
+  size_t read = std::fread(buffer_.get() + size_, 1, requested, file_);
+  size_ += read;
+  at_end_ = read < requested;
+  if (limited && !at_end_) {
+    at_end_ = true;
+    too_large_ = std::fgetc(file_) != EOF;
+  }
+  return read != 0;
+}
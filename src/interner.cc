@@ -0,0 +1,184 @@
+#include "interner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include "hash.h"
+
+namespace {
+
+// Recently interned strings of the calling thread, checked before taking a
+// shard lock. Entries are tagged with the interner's generation so a new
+// interner never sees symbols of a destroyed one.
+struct CachedSymbol {
+  uint64_t generation;
+  uint64_t hash;
+  Symbol symbol;
+};
+
+constexpr size_t kCacheSize = 1024;
+
+thread_local std::array<CachedSymbol, kCacheSize> tCache{};
+
+// the counters of the interner with this generation
+thread_local uint64_t tCountersGeneration = 0;
+thread_local std::shared_ptr<void> tCounters;
+
+std::atomic<uint64_t> sGenerationCounter{1};
+
+struct BlockPosition {
+  size_t block;
+  size_t offset;
+};
+
+BlockPosition Locate(uint32_t index, int first_block_bits) {
+  size_t biased = static_cast<size_t>(index) + (size_t{1} << first_block_bits);
+  size_t top = std::bit_width(biased) - 1;
+  return {top - first_block_bits, biased - (size_t{1} << top)};
+}
+
+}  // namespace
+
+Interner::Interner()
+    : generation_(sGenerationCounter.fetch_add(1, std::memory_order_relaxed)),
+      shards_(std::make_unique<Shard[]>(kShardCount)) {
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shards_[i].slots.resize(64);
+  }
+}
+
+Interner::~Interner() {
+  for (size_t i = 0; i < kShardCount; ++i) {
+    for (auto& block : shards_[i].blocks) {
+      delete[] block.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+Interner& Interner::Global() {
+  static Interner interner;
+  return interner;
+}
+
+Symbol Interner::Intern(std::string_view str) {
+  uint64_t full_hash = HashString(str);
+  uint32_t shard_index = full_hash & (kShardCount - 1);
+  uint32_t hash = static_cast<uint32_t>(full_hash >> 32);
+  Shard& shard = shards_[shard_index];
+  // only this thread writes its counters, a plain store is enough
+  ThreadCounters& counters = Counters();
+  counters.lookups.store(counters.lookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  CachedSymbol& cached = tCache[(full_hash >> 40) & (kCacheSize - 1)];
+  if (cached.generation == generation_ && cached.hash == full_hash && Lookup(cached.symbol) == str) {
+    counters.hits.store(counters.hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return cached.symbol;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  size_t mask = shard.slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Slot& slot = shard.slots[i];
+    if (slot.entry == 0) {
+      break;
+    }
+    if (slot.hash == hash) {
+      Symbol symbol = (slot.entry - 1) << kShardBits | shard_index;
+      if (Lookup(symbol) == str) {
+        counters.hits.store(counters.hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        cached = {generation_, full_hash, symbol};
+        return symbol;
+      }
+    }
+  }
+
+  uint32_t index = shard.count++;
+  BlockPosition position = Locate(index, kFirstBlockBits);
+  std::string_view* block = shard.blocks[position.block].load(std::memory_order_relaxed);
+  if (block == nullptr) {
+    block = new std::string_view[size_t{1} << (kFirstBlockBits + position.block)];
+    shard.blocks[position.block].store(block, std::memory_order_release);
+  }
+  block[position.offset] = Store(shard, str);
+
+  if (shard.count * 2 > shard.slots.size()) {
+    Grow(shard);
+  }
+  mask = shard.slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    if (shard.slots[i].entry == 0) {
+      shard.slots[i] = {hash, index + 1};
+      break;
+    }
+  }
+  Symbol symbol = index << kShardBits | shard_index;
+  cached = {generation_, full_hash, symbol};
+  return symbol;
+}
+
+std::string_view Interner::Lookup(Symbol symbol) const {
+  const Shard& shard = shards_[symbol & (kShardCount - 1)];
+  BlockPosition position = Locate(symbol >> kShardBits, kFirstBlockBits);
+  return shard.blocks[position.block].load(std::memory_order_acquire)[position.offset];
+}
+
+InternerStats Interner::Stats() const {
+  InternerStats stats;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    const Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.unique_count += shard.count;
+    stats.bytes += shard.bytes;
+  }
+  std::lock_guard<std::mutex> lock(counters_mutex_);
+  for (const auto& counters : counters_) {
+    stats.lookups += counters->lookups.load(std::memory_order_relaxed);
+    stats.hits += counters->hits.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+Interner::ThreadCounters& Interner::Counters() {
+  if (tCountersGeneration != generation_) {
+    auto counters = std::make_shared<ThreadCounters>();
+    {
+      std::lock_guard<std::mutex> lock(counters_mutex_);
+      counters_.push_back(counters);
+    }
+    tCountersGeneration = generation_;
+    tCounters = std::move(counters);
+  }
+  return *static_cast<ThreadCounters*>(tCounters.get());
+}
+
+std::string_view Interner::Store(Shard& shard, std::string_view str) {
+  if (str.size() > shard.arena_remaining) {
+    size_t size = std::max(kArenaChunkSize, str.size());
+    shard.arena.push_back(std::make_unique<char[]>(size));
+    shard.arena_cursor = shard.arena.back().get();
+    shard.arena_remaining = size;
+  }
+  char* data = shard.arena_cursor;
+  std::memcpy(data, str.data(), str.size());
+  shard.arena_cursor += str.size();
+  shard.arena_remaining -= str.size();
+  shard.bytes += str.size();
+  return {data, str.size()};
+}
+
+void Interner::Grow(Shard& shard) {
+  std::vector<Slot> slots(shard.slots.size() * 2);
+  size_t mask = slots.size() - 1;
+  for (const Slot& slot : shard.slots) {
+    if (slot.entry == 0) {
+      continue;
+    }
+    for (size_t i = slot.hash & mask;; i = (i + 1) & mask) {
+      if (slots[i].entry == 0) {
+        slots[i] = slot;
+        break;
+      }
+    }
+  }
+  shard.slots = std::move(slots);
+}
@@ -1,259 +1,563 @@
 #include "lexer.h"
 
-Lexer::Lexer(std::string file, std::stringstream& source, ErrorHandler& error_handler) : file_(file), source_(source), error_handler_(error_handler) {
-  line_number_ = 1;
-  char_index_ = 0;
-  UpdateLine();
-}
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include "simd_scan.h"
+#include "token_buffer.h"
+#include "utf8.h"
 
-std::shared_ptr<Lexeme> Lexer::Next() {
-  char c;
-  while (true) {
-    if (source_.tellg() == EOF) {
-      return std::make_shared<Lexeme>(file_, "", TokenTypeEndOfFile, line_, line_number_, char_index_);
-    }
-    source_.get(c);
-    char_index_++;
-    if (c == '\n') {
-      line_number_++;
-      char_index_ = 0;
-      UpdateLine();
-      continue;
+namespace {
+
+// bytes validated as UTF-8 at a time
+constexpr size_t kUtf8BlockSize = 64 * 1024;
+
+// Converts the text of a number token, including ' separators and type
+// suffixes, to its binary value. Returns the error, if any.
+DiagnosticId ParseNumber(std::string_view text, TokenType type, TokenPayload& payload) {
+  char buffer[64];
+  std::string long_buffer;
+  char* digits = buffer;
+  if (text.size() > sizeof(buffer)) {
+    long_buffer.resize(text.size());
+    digits = long_buffer.data();
+  }
+  size_t size = 0;
+  for (char c : text) {
+    if (c != '\'') {
+      digits[size++] = c;
     }
-    if (!IsEmpty(c)) {
+  }
+  while (size > 0 && IsDigitType(digits[size - 1])) {
+    size--;
+  }
+  const char* first = digits;
+  const char* last = digits + size;
+
+  payload.bits = 0;
+  std::from_chars_result result{};
+  switch (type) {
+    case TokenTypeNumberInt32: {
+      int64_t value = 0;
+      result = std::from_chars(first, last, value);
+      if (result.ec == std::errc::result_out_of_range || value > INT32_MAX) {
+        return DiagnosticIdInt32TooLarge;
+      }
+      payload.int32 = static_cast<int32_t>(value);
       break;
     }
-  }
-  // handle comments
-  if (c == '/') {
-    if (source_.peek() == '/') {
-      std::string comment = "/";
-      int start_char_index = char_index_;
-      int start_line_number = line_number_;
-      std::string start_line = line_;
-      while (true) {
-        if (source_.tellg() == EOF) {
-          break;
-        }
-        source_.get(c);
-        char_index_++;
-        if (c == '\n') {
-          line_number_++;
-          char_index_ = 0;
-          UpdateLine();
-          break;
-        }
-        comment += c;
+    case TokenTypeNumberInt64:
+      result = std::from_chars(first, last, payload.int64);
+      if (result.ec == std::errc::result_out_of_range) {
+        return DiagnosticIdInt64TooLarge;
       }
-      return std::make_shared<Lexeme>(file_, comment, TokenTypeComment, start_line, start_line_number, start_char_index);
-    } else if (source_.peek() == '*') {
-      std::string comment = "/";
-      int start_char_index = char_index_;
-      int start_line_number = line_number_;
-      std::string start_line = line_;
-      bool terminated = false;
-      while (true) {
-        if (source_.tellg() == EOF) {
-          break;
-        }
-        source_.get(c);
-        char_index_++;
-        if (c == '\n') {
-          line_number_++;
-          char_index_ = 0;
-          UpdateLine();
-          comment += ' ';
-        } else {
-          comment += c;
-        }
-        if (c == '*' && source_.peek() == '/') {
-          source_.get(c);
-          char_index_++;
-          comment += c;
-          terminated = true;
-          break;
-        }
+      break;
+    case TokenTypeNumberFloat:
+      result = std::from_chars(first, last, payload.float32);
+      if (result.ec == std::errc::result_out_of_range) {
+        return DiagnosticIdFloatOutOfRange;
       }
-      if (!terminated) {
-        error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Unterminated comment");
+      break;
+    case TokenTypeNumberDouble:
+      result = std::from_chars(first, last, payload.float64);
+      if (result.ec == std::errc::result_out_of_range) {
+        return DiagnosticIdDoubleOutOfRange;
       }
-      return std::make_shared<Lexeme>(file_, comment, TokenTypeComment, start_line, start_line_number, start_char_index);
+      break;
+    default:
+      return DiagnosticIdInvalidNumber;
+  }
+  if (result.ec != std::errc() || result.ptr != last) {
+    return DiagnosticIdInvalidNumber;
+  }
+  return DiagnosticIdNone;
+}
+
+bool IsHexDigit(char c) {
+  return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+// Returns the end of the escape sequence that starts with the backslash at
+// p. It looks at most one byte past it.
+const char* SkipEscape(const char* p, const char* end) {
+  p++;
+  if (p == end || *p == '\n') {
+    return p;
+  }
+  if (*p == 'u' && end - p >= 2 && p[1] == '{') {
+    p += 2;
+    while (p != end && IsHexDigit(*p)) {
+      p++;
+    }
+    return p != end && *p == '}' ? p + 1 : p;
+  }
+  do {
+    p++;
+  } while (p != end && IsUtf8Continuation(*p));
+  return p;
+}
+
+}  // namespace
+
+Lexer::Lexer(const SourceManager& sources, FileId file_id, Arena& arena, ErrorHandler& error_handler,
+             LexerOptions options)
+    : file_id_(file_id),
+      options_(options),
+      begin_(sources.Buffer(file_id).data()),
+      cursor_(begin_),
+      end_(begin_ + sources.Buffer(file_id).size()),
+      arena_(arena),
+      error_handler_(error_handler),
+      interner_(Interner::Global()) {
+}
+
+Lexer::Lexer(InputStream& input, SourceManager& sources, FileId file_id, Arena& arena, ErrorHandler& error_handler,
+             LexerOptions options)
+    : file_id_(file_id),
+      options_(options),
+      begin_(input.Data()),
+      cursor_(begin_),
+      end_(begin_),
+      input_(&input),
+      stream_sources_(&sources),
+      arena_(arena),
+      error_handler_(error_handler),
+      interner_(Interner::Global()) {
+  Refill(cursor_);
+}
+
+Lexer::Lexer(const TokenBuffer& tokens, const std::vector<ErrorData>& errors, Arena& arena, ErrorHandler& error_handler,
+             LexerOptions options)
+    : file_id_(tokens.GetFileId()),
+      options_(options),
+      begin_(tokens.Source().data()),
+      cursor_(begin_),
+      end_(begin_ + tokens.Source().size()),
+      replay_(&tokens),
+      replay_errors_(&errors),
+      arena_(arena),
+      error_handler_(error_handler),
+      interner_(Interner::Global()) {
+}
+
+Lexeme* Lexer::Next() {
+  return arena_.Create<Lexeme>(Lex());
+}
+
+Lexeme Lexer::Lex() {
+  if (error_handler_.LimitReached()) {
+    return Stop();
+  }
+  auto scan = [this] { return replay_ != nullptr ? Replay() : input_ != nullptr ? ScanStream() : Scan(); };
+  Lexeme lexeme = scan();
+  if (lexeme.Type() != TokenTypeComment || options_.comments == CommentModeToken) {
+    return lexeme;
+  }
+  uint32_t trivia_start = lexeme.Location().offset;
+  uint32_t trivia_end = trivia_start;
+  do {
+    // the value of a comment spans all of it
+    trivia_end = lexeme.Location().offset + static_cast<uint32_t>(lexeme.Value().size());
+    lexeme = scan();
+  } while (lexeme.Type() == TokenTypeComment);
+  if (options_.comments == CommentModeTrivia) {
+    lexeme.SetTrivia({trivia_start, trivia_end - trivia_start});
+  }
+  return lexeme;
+}
+
+Lexeme Lexer::Replay() {
+  if (replay_index_ == replay_->Size()) {
+    return Lexeme({}, TokenTypeEndOfFile, Location(end_));
+  }
+  // the end of file token is handed out again on every further call
+  size_t i = replay_index_;
+  if (replay_->Type(i) != TokenTypeEndOfFile) {
+    replay_index_++;
+  }
+  const auto& errors = *replay_errors_;
+  while (replay_error_index_ < errors.size() && errors[replay_error_index_].location.offset <= replay_->Offset(i)) {
+    error_handler_.PushError(errors[replay_error_index_++]);
+  }
+  TokenType type = replay_->Type(i);
+  std::string_view value = replay_->Value(i);
+  if (IsTokenNumber(type)) {
+    return Lexeme(value, type, replay_->Location(i), replay_->Number(i));
+  }
+  if (type == TokenTypeOperator || type == TokenTypePunctuation) {
+    return Lexeme(value, type, replay_->Location(i), LookupOperator(value));
+  }
+  KeywordType keyword = type == TokenTypeKeyword ? LookupKeyword(value) : KeywordTypeNone;
+  return Lexeme(value, type, replay_->Location(i), keyword, replay_->ValueId(i));
+}
+
+Lexeme Lexer::ScanStream() {
+  while (true) {
+    cursor_ = SkipWhitespace(cursor_, end_);
+    const char* start = cursor_;
+    size_t error_count = error_handler_.Errors().size();
+    uint32_t utf8_checked = utf8_checked_;
+    bool utf8_invalid = utf8_invalid_;
+    Lexeme lexeme = Scan();
+    if (CutOff()) {
+      // lexed again once more input has been read
+      error_handler_.TruncateErrors(error_count);
+      cursor_ = start;
+      // what lies between the last check and start is whitespace, which
+      // the refill may drop
+      utf8_checked_ = std::max(utf8_checked, Offset());
+      utf8_invalid_ = utf8_invalid;
+      Refill(start);
+      continue;
+    }
+    if (lexeme.Type() == TokenTypeEndOfFile && input_->TooLarge() && !too_large_reported_) {
+      error_handler_.PushError(lexeme.Location(), DiagnosticIdInputTooLarge);
+      too_large_reported_ = true;
+    }
+    std::string_view value = lexeme.Value();
+    if (lexeme.Type() == TokenTypeComment && options_.comments != CommentModeToken) {
+      // only its extent is needed
+    } else if (lexeme.Type() == TokenTypeKeyword) {
+      lexeme.SetValue(kKeywordNames[lexeme.Keyword()]);
+    } else if (lexeme.Operator() != OperatorIdNone) {
+      lexeme.SetValue(kOperatorNames[lexeme.Operator()]);
+    } else if (lexeme.GetSymbol() != kNoSymbol) {
+      lexeme.SetValue(interner_.Lookup(lexeme.GetSymbol()));
+    } else if (!value.empty()) {
+      // the window moves on, numbers and comments keep their text in the
+      // interner, which stores repeated values once
+      lexeme.SetValue(interner_.Lookup(interner_.Intern(value)));
+    }
+    return lexeme;
+  }
+}
+
+void Lexer::Refill(const char* keep) {
+  // keep the start of the current line around for diagnostics
+  std::string_view before(begin_, keep - begin_);
+  size_t newline = before.rfind('\n');
+  const char* line_start = newline == std::string_view::npos ? begin_ : begin_ + newline + 1;
+  if (static_cast<size_t>(keep - line_start) > input_->Capacity() / 2) {
+    line_start = keep;
+  }
+  std::string_view dropped(begin_, line_start - begin_);
+  size_t last_newline = dropped.rfind('\n');
+  if (last_newline != std::string_view::npos) {
+    window_line_ += static_cast<int>(std::count(dropped.begin(), dropped.end(), '\n'));
+    window_line_start_ = base_ + static_cast<uint32_t>(last_newline) + 1;
+    window_line_columns_ = 0;
+  }
+  window_line_columns_ += static_cast<int>(
+      CountCodePoints(dropped.substr(last_newline == std::string_view::npos ? 0 : last_newline + 1)));
+
+  uint32_t cursor = Offset();
+  input_->Refill(line_start);
+  begin_ = input_->Data();
+  end_ = begin_ + input_->Size();
+  base_ = input_->Base();
+  cursor_ = begin_ + (cursor - base_);
+  stream_sources_->SetStreamWindow(file_id_, std::string_view(begin_, end_ - begin_), base_, window_line_,
+                                   window_line_start_, window_line_columns_);
+}
+
+void Lexer::TokenizeAll(TokenBuffer& tokens) {
+  TokenizeUntil(tokens, UINT32_MAX);
+}
+
+bool Lexer::TokenizeNext(TokenBuffer& tokens) {
+  Lexeme lexeme = options_.comments != CommentModeToken ? Lex() : error_handler_.LimitReached() ? Stop() : Scan();
+  if (lexeme.Trivia().length != 0) {
+    tokens.PushTrivia(lexeme.Trivia());
+  }
+  TokenType type = lexeme.Type();
+  uint32_t offset = lexeme.Location().offset;
+  uint32_t value_id = IsTokenNumber(type) ? tokens.AddConstant(lexeme.Payload()) : lexeme.GetSymbol();
+  tokens.Push(type, offset, static_cast<uint32_t>(cursor_ - begin_) - offset, value_id);
+  return type != TokenTypeEndOfFile;
+}
+
+bool Lexer::TokenizeUntil(TokenBuffer& tokens, uint32_t end_offset) {
+  tokens.SetSource(file_id_, std::string_view(begin_, end_ - begin_));
+  // roughly one token per five bytes of source
+  size_t remaining = std::min<size_t>(end_ - cursor_, end_offset > Offset() ? end_offset - Offset() : 0);
+  tokens.Reserve(tokens.Size() + remaining / 5 + 1);
+  while (true) {
+    cursor_ = SkipWhitespace(cursor_, end_);
+    if (cursor_ != end_ && Offset() >= end_offset) {
+      return false;
+    }
+    if (!TokenizeNext(tokens)) {
+      return true;
     }
   }
+}
 
-  if (IsOperator(c)) {
-    return std::make_shared<Lexeme>(file_, std::string{c}, TokenTypeOperator, line_, line_number_, char_index_);
-  } else if (IsPunctuation(c)) {
-    return std::make_shared<Lexeme>(file_, std::string{c}, TokenTypePunctuation, line_, line_number_, char_index_);
-  } else if (IsDigit(c)) {
-    std::string lexeme;
-    lexeme += c;
-    int start_char_index = char_index_;
-    int start_line_number = line_number_;
-    std::string start_line = line_;
-    bool is_float = false;
-    bool is_long = false;
-    bool is_floating_number = false;
-    bool should_continue = false;
-    while (true) {
-      if (source_.tellg() == EOF) {
+Lexeme Lexer::Stop() {
+  cursor_ = end_;
+  return Lexeme({}, TokenTypeEndOfFile, Location(end_));
+}
+
+Lexeme Lexer::Scan() {
+  Lexeme lexeme = ScanToken();
+  if (Offset() > utf8_checked_) {
+    CheckUtf8();
+  }
+  return lexeme;
+}
+
+std::string_view Lexer::DecodeEscapes(std::string_view text) {
+  escape_buffer_.clear();
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p != end) {
+    const char* backslash = static_cast<const char*>(std::memchr(p, '\\', end - p));
+    if (backslash == nullptr) {
+      escape_buffer_.append(p, end);
+      break;
+    }
+    escape_buffer_.append(p, backslash);
+    p = SkipEscape(backslash, end);
+    if (p == backslash + 1) {
+      // the literal ended right after the backslash
+      continue;
+    }
+    switch (backslash[1]) {
+      case 'n':
+        escape_buffer_ += '\n';
         break;
-      }
-      source_.get(c);
-      char_index_++;
-      if (c == '\n') {
-        line_number_++;
-        char_index_ = 0;
-        UpdateLine();
+      case 't':
+        escape_buffer_ += '\t';
         break;
-      }
-      if (c == '\'') {
-        // ' can be used as a separator for numbers like 1'000'000
-        should_continue = true;
-        continue;
-      }
-      if (c == ';' || IsEmpty(c)) {
-        char_index_--;
-        source_.unget();
+      case 'r':
+        escape_buffer_ += '\r';
         break;
-      }
-      if (c == '.') {
-        if (is_floating_number) {
-          std::string cstr{c};
-          error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Invalid suffix '" + cstr + "'character in floating constant");
+      case '0':
+        escape_buffer_ += '\0';
+        break;
+      case '\\':
+      case '"':
+      case '\'':
+        escape_buffer_ += backslash[1];
+        break;
+      case 'u': {
+        // \u{X} with one to six hex digits
+        size_t digits = p - backslash - 4;
+        char32_t code_point = 0;
+        bool valid = p - backslash >= 5 && p[-1] == '}' && digits <= 6;
+        for (size_t i = 0; valid && i < digits; ++i) {
+          char c = backslash[3 + i];
+          code_point = code_point * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
         }
-        is_floating_number = true;
-      } else if (c == 'f' || c == 'F') {
-        is_float = true;
-        is_floating_number = true;
-      } else if (c == 'l' || c == 'L') {
-        is_long = true;
-      } else if (!IsDigit(c)) {
-        char_index_--;
-        source_.unget();
+        if (valid && code_point <= 0x10FFFF && (code_point < 0xD800 || code_point > 0xDFFF)) {
+          char encoded[4];
+          escape_buffer_.append(encoded, EncodeUtf8(code_point, encoded));
+        } else {
+          error_handler_.PushError(Location(backslash), DiagnosticIdInvalidUnicodeEscape);
+        }
+        break;
+      }
+      default:
+        error_handler_.PushError(Location(backslash), DiagnosticIdUnknownEscape,
+                                 std::string_view(backslash + 1, p - backslash - 1));
+        escape_buffer_.append(backslash + 1, p);
         break;
+    }
+  }
+  return escape_buffer_;
+}
+
+Symbol Lexer::Intern(std::string_view value) {
+  return CutOff() ? kNoSymbol : interner_.Intern(value);
+}
+
+void Lexer::CheckUtf8() {
+  uint32_t offset = Offset();
+  bool at_end = input_ == nullptr || input_->AtEnd();
+  while (utf8_checked_ < offset) {
+    const char* p = begin_ + (utf8_checked_ - base_);
+    if (utf8_invalid_) {
+      error_handler_.PushError(Location(p), DiagnosticIdInvalidUtf8);
+      // continuation bytes cannot start a sequence either
+      do {
+        p++;
+      } while (p != end_ && IsUtf8Continuation(*p));
+      utf8_checked_ = base_ + static_cast<uint32_t>(p - begin_);
+      utf8_invalid_ = false;
+      continue;
+    }
+    const char* limit = static_cast<size_t>(end_ - p) > kUtf8BlockSize ? p + kUtf8BlockSize : end_;
+    const char* invalid = FindInvalidUtf8(p, limit);
+    utf8_checked_ = base_ + static_cast<uint32_t>(invalid - begin_);
+    if (invalid == limit) {
+      continue;
+    }
+    if (limit != end_) {
+      // the sequence may only be cut off by the block's end
+      utf8_invalid_ = FindInvalidUtf8(invalid, std::min(invalid + 4, end_)) == invalid;
+    } else if (!at_end && IsCutOffUtf8(invalid, end_)) {
+      // or by the end of the stream's window, which the token reaches, so it
+      // is lexed again after a refill
+      return;
+    } else {
+      utf8_invalid_ = true;
+    }
+  }
+}
+
+Lexeme Lexer::ScanToken() {
+  cursor_ = SkipWhitespace(cursor_, end_);
+  if (cursor_ == end_) {
+    return Lexeme({}, TokenTypeEndOfFile, Location(cursor_));
+  }
+  const char* start = cursor_;
+  SourceLocation start_location = Location(start);
+  TokenMatch match = MatchToken(cursor_, end_);
+  // every byte but whitespace starts some token, this is only a safeguard
+  cursor_ = match.rule == TokenRuleNone ? start + 1 : match.end;
+  std::string_view text(start, cursor_ - start);
+
+  switch (match.rule) {
+    case TokenRuleOperator:
+      return Lexeme(text, TokenTypeOperator, start_location, match.op);
+    case TokenRulePunctuation:
+      return Lexeme(text, TokenTypePunctuation, start_location, match.op);
+    case TokenRuleLineComment:
+      cursor_ = FindNewline(cursor_, end_);
+      return Lexeme(std::string_view(start, cursor_ - start), TokenTypeComment, start_location);
+    case TokenRuleBlockComment: {
+      const char* comment_end = FindCommentEnd(cursor_, end_);
+      bool terminated = comment_end != end_;
+      cursor_ = terminated ? comment_end + 2 : end_;
+      if (!terminated) {
+        error_handler_.PushError(start_location, DiagnosticIdUnterminatedComment);
       }
-      lexeme += c;
-      should_continue = false;
+      return Lexeme(std::string_view(start, cursor_ - start), TokenTypeComment, start_location);
     }
-    TokenType type;
-    if (is_floating_number) {
-      if (is_float) {
-        type = TokenTypeNumberFloat;
+    case TokenRuleNumber: {
+      // the DFA matched the whole number, its suffixes decide the type
+      bool is_float = false;
+      bool is_long = false;
+      bool is_floating_number = false;
+      bool malformed = false;
+      for (char c : text) {
+        if (c == '.') {
+          if (is_floating_number) {
+            error_handler_.PushError(start_location, DiagnosticIdInvalidFloatSuffix);
+            malformed = true;
+          }
+          is_floating_number = true;
+        } else if (c == 'f' || c == 'F') {
+          is_float = true;
+          is_floating_number = true;
+        } else if (c == 'l' || c == 'L') {
+          is_long = true;
+        }
+      }
+      TokenType type;
+      if (is_floating_number) {
+        if (is_float) {
+          type = TokenTypeNumberFloat;
+        } else {
+          type = TokenTypeNumberDouble;
+        }
       } else {
-        type = TokenTypeNumberDouble;
+        if (is_long) {
+          type = TokenTypeNumberInt64;
+        } else {
+          type = TokenTypeNumberInt32;
+        }
       }
-    } else {
-      if (is_long) {
-        type = TokenTypeNumberInt64;
+      if (text.back() == '\'') {
+        error_handler_.PushError(start_location, DiagnosticIdLeadingSeparator);
+      }
+      TokenPayload payload;
+      if (!malformed) {
+        if (DiagnosticId error = ParseNumber(text, type, payload)) {
+          error_handler_.PushError(start_location, error);
+        }
       } else {
-        type = TokenTypeNumberInt32;
+        payload.bits = 0;
       }
+      return Lexeme(text, type, start_location, payload);
     }
-    if (should_continue) {
-      error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Leading separators are not allowed");
-    }
-    return std::make_shared<Lexeme>(file_, lexeme, type, start_line, start_line_number, start_char_index);
-  } else if (c == '"') {
-    std::string lexeme = "";
-    int start_char_index = char_index_;
-    int start_line_number = line_number_;
-    std::string start_line = line_;
-    bool is_escaped = false;
-    while (true) {
-      if (source_.tellg() == EOF) {
-        break;
+    case TokenRuleString: {
+      const char* value_start = cursor_;
+      bool terminated = false;
+      bool has_escapes = false;
+      while (true) {
+        cursor_ = FindStringEnd(cursor_, end_);
+        if (cursor_ == end_ || *cursor_ == '\n') {
+          break;
+        }
+        if (*cursor_ == '"') {
+          terminated = true;
+          break;
+        }
+        // skip the backslash and the character it escapes
+        has_escapes = true;
+        cursor_++;
+        if (cursor_ != end_ && *cursor_ != '\n') {
+          cursor_++;
+        }
       }
-      source_.get(c);
-      char_index_++;
-      if (c == '\n') {
-        line_number_++;
-        char_index_ = 0;
-        UpdateLine();
-        break;
+      std::string_view lexeme(value_start, cursor_ - value_start);
+      if (terminated) {
+        cursor_++;
+      } else {
+        error_handler_.PushError(start_location, DiagnosticIdUnterminatedString);
       }
-      if (c == '"') {
-        is_escaped = true;
-        break;
+      if (has_escapes) {
+        std::string_view decoded = DecodeEscapes(lexeme);
+        Symbol symbol = Intern(decoded);
+        return Lexeme(symbol != kNoSymbol ? interner_.Lookup(symbol) : decoded, TokenTypeStringLiteral, start_location,
+                      KeywordTypeNone, symbol);
       }
-      lexeme += c;
+      return Lexeme(lexeme, TokenTypeStringLiteral, start_location, KeywordTypeNone, Intern(lexeme));
     }
-    if (!is_escaped) {
-      error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Unterminated string literal");
-    }
-    return std::make_shared<Lexeme>(file_, lexeme, TokenTypeStringLiteral, start_line, start_line_number, start_char_index);
-  } else if (c == '\'') {
-    int start_char_index = char_index_;
-    int start_line_number = line_number_;
-    std::string start_line = line_;
-    char character;
-    source_.get(character);
-    char_index_++;
-    if (c == '\n') {
-      line_number_++;
-      char_index_ = 0;
-      UpdateLine();
-      error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Unexpected end of line in character constant");
-    }
-    source_.get(c);
-    char_index_++;
-    if (c != '\'') {
-      error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Unterminated character constant");
-    }
-    return std::make_shared<Lexeme>(file_, std::string{character}, TokenTypeCharacterLiteral, line_, line_number_, char_index_);
-  } else {
-    std::string lexeme;
-    lexeme += c;
-    int start_char_index = char_index_;
-    int start_line_number = line_number_;
-    std::string start_line = line_;
-    while (true) {
-      source_.get(c);
-      char_index_++;
-      if (c == '\n') {
-        line_number_++;
-        char_index_ = 0;
-        UpdateLine();
-        break;
+    case TokenRuleCharacter: {
+      if (cursor_ == end_ || *cursor_ == '\n') {
+        error_handler_.PushError(start_location, DiagnosticIdEndOfLineInCharacter);
+        return Lexeme("", TokenTypeCharacterLiteral, start_location, KeywordTypeNone, Intern(""));
       }
-      if (IsEmpty(c)) {
-        break;
+      // one code point or escape sequence; a malformed sequence, which
+      // CheckUtf8 reports, is taken as a whole
+      int length;
+      if (*cursor_ == '\\') {
+        length = static_cast<int>(SkipEscape(cursor_, end_) - cursor_);
+      } else {
+        char32_t code_point;
+        length = DecodeUtf8(cursor_, end_, code_point);
+        if (length == 0) {
+          do {
+            length++;
+          } while (length < 4 && cursor_ + length != end_ && IsUtf8Continuation(cursor_[length]));
+        }
       }
-      if (IsPunctuation(c) || IsOperator(c)) {
-        char_index_--;
-        source_.unget();
-        break;
+      std::string_view character(cursor_, length);
+      cursor_ += length;
+      if (cursor_ == end_ || *cursor_ != '\'') {
+        error_handler_.PushError(start_location, DiagnosticIdUnterminatedCharacter);
+      } else {
+        cursor_++;
       }
-      lexeme += c;
+      if (character[0] == '\\') {
+        std::string_view decoded = DecodeEscapes(character);
+        Symbol symbol = Intern(decoded);
+        return Lexeme(symbol != kNoSymbol ? interner_.Lookup(symbol) : decoded, TokenTypeCharacterLiteral,
+                      start_location, KeywordTypeNone, symbol);
+      }
+      return Lexeme(character, TokenTypeCharacterLiteral, start_location, KeywordTypeNone, Intern(character));
     }
-    if (IsKeyword(lexeme)) {
-      return std::make_shared<Lexeme>(file_, lexeme, TokenTypeKeyword, start_line, start_line_number, start_char_index);
-    } else {
-      if (!IsIdentifier(lexeme)) {
-        error_handler_.PushError(file_, start_line, start_line_number, start_char_index, "Invalid identifier name");
+    default: {
+      KeywordType keyword = LookupKeyword(text);
+      if (keyword != KeywordTypeNone) {
+        return Lexeme(text, TokenTypeKeyword, start_location, keyword);
+      }
+      if (!IsIdentifier(text)) {
+        error_handler_.PushError(start_location, DiagnosticIdInvalidIdentifier);
       }
-      return std::make_shared<Lexeme>(file_, lexeme, TokenTypeIdentifier, start_line, start_line_number, start_char_index);
+      return Lexeme(text, TokenTypeIdentifier, start_location, KeywordTypeNone, Intern(text));
     }
   }
 }
-
-void Lexer::UpdateLine() {
-  line_ = "";
-  int pos = source_.tellg();
-  char c;
-  if (char_index_ > 0) {
-    source_.seekg(pos - char_index_);
-  }
-  do {
-    if (source_.eof()) {
-      return;
-    }
-    source_.get(c);
-    if (c == '\n') {
-      source_.seekg(pos);
-      break;
-    }
-    line_ += c;
-  } while (true);
-  source_.seekg(pos);
-}
\ No newline at end of file
@@ -1,28 +1,158 @@
+
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include "arena.h"
+#include "bench.h"
 #include "lexer.h"
 #include "error_handler.h"
+#include "input_stream.h"
+#include "interner.h"
 #include "parser.h"
+#include "source_manager.h"
+#include "token_buffer.h"
+#include "token_cache.h"
 
+void PrintStats(const Arena& arena, std::ostream& out) {
+  InternerStats interner = Interner::Global().Stats();
+  out << "interner: " << interner.unique_count << " unique strings, "
+      << interner.bytes << " bytes, "
+      << interner.HitRate() * 100.0 << "% hit rate ("
+      << interner.hits << "/" << interner.lookups << ")" << std::endl;
+  out << "arena: " << arena.BytesUsed() << " bytes used, "
+      << arena.HighWaterMark() << " bytes high-water mark, "
+      << arena.BytesReserved() << " bytes in " << arena.BlockCount() << " blocks" << std::endl;
+}
 
-int main() {
+int main(int argc, char** argv) {
   Grammar grammar{"grammar.json"};
   //grammar.Print();
 
   std::filesystem::path path = "main.sls";
-  std::ifstream stream;
-  stream.open(path, std::ios::in);
-  std::stringstream buffer;
-  buffer << stream.rdbuf();
-  stream.close();
+  bool bench_lexer = false;
+  bool bench_parallel = false;
+  bool bench_incremental = false;
+  bool bench_parser = false;
+  bool dump_ast = false;
+  bool print_stats = false;
+  // 0 for no limit; fail-fast stops at the first error
+  size_t max_errors = 0;
+  DiagnosticFormat diagnostics_format = DiagnosticFormatText;
+  std::optional<std::filesystem::path> diagnostics_output;
+  std::optional<std::filesystem::path> token_cache_directory;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--bench-lexer") {
+      bench_lexer = true;
+    } else if (arg == "--bench-parallel") {
+      bench_parallel = true;
+    } else if (arg == "--bench-incremental") {
+      bench_incremental = true;
+    } else if (arg == "--bench-parser") {
+      bench_parser = true;
+    } else if (arg == "--dump-ast") {
+      dump_ast = true;
+    } else if (arg == "--token-cache") {
+      token_cache_directory = ".sono-cache";
+    } else if (arg.starts_with("--token-cache=")) {
+      token_cache_directory = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--stats") {
+      print_stats = true;
+    } else if (arg.starts_with("--diagnostics-format=")) {
+      std::string_view format = arg.substr(arg.find('=') + 1);
+      if (format == "text") {
+        diagnostics_format = DiagnosticFormatText;
+      } else if (format == "jsonl") {
+        diagnostics_format = DiagnosticFormatJsonLines;
+      } else if (format == "sarif") {
+        diagnostics_format = DiagnosticFormatSarif;
+      } else {
+        std::cerr << "error: unknown diagnostics format " << format << std::endl;
+        return 1;
+      }
+    } else if (arg.starts_with("--diagnostics-output=")) {
+      diagnostics_output = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--fail-fast") {
+      max_errors = 1;
+    } else if (arg.starts_with("--max-errors=")) {
+      std::string_view value = arg.substr(arg.find('=') + 1);
+      auto result = std::from_chars(value.data(), value.data() + value.size(), max_errors);
+      if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+        std::cerr << "error: invalid error limit " << value << std::endl;
+        return 1;
+      }
+    } else {
+      path = arg;
+    }
+  }
+
+  SourceManager sources{};
+  bool from_stdin = path == "-";
+  FileId file_id = from_stdin ? sources.AddStream("<stdin>") : sources.AddFile(path.string());
+  if (file_id == kInvalidFileId) {
+    std::cerr << "error: could not open " << path.string() << std::endl;
+    return 1;
+  }
 
-  std::string absolute_path = std::filesystem::absolute(path).string();
+  if (from_stdin && (bench_lexer || bench_parallel || bench_incremental || bench_parser)) {
+    std::cerr << "error: benchmarks need a file" << std::endl;
+    return 1;
+  }
+
+  if (bench_lexer) {
+    BenchLexer(sources, file_id, 5);
+    return 0;
+  }
+
+  if (bench_parallel) {
+    return BenchParallelLexer(sources, file_id, 5, std::max(4u, std::thread::hardware_concurrency())) ? 0 : 1;
+  }
+
+  if (bench_incremental) {
+    BenchIncrementalLexer(sources, file_id, 20);
+    return 0;
+  }
+
+  if (bench_parser) {
+    BenchParser(sources, file_id, 5);
+    return 0;
+  }
+
+  std::FILE* diagnostics_file = stdout;
+  if (diagnostics_output) {
+    diagnostics_file = std::fopen(diagnostics_output->string().c_str(), "wb");
+    if (diagnostics_file == nullptr) {
+      std::cerr << "error: could not open " << diagnostics_output->string() << std::endl;
+      return 1;
+    }
+  }
+  // machine-readable diagnostics on stdout must not be mixed with anything else
+  bool diagnostics_own_stdout = diagnostics_file == stdout && diagnostics_format != DiagnosticFormatText;
+  std::ostream& out = diagnostics_own_stdout ? std::cerr : std::cout;
 
   // todo preprocessed input stream class
-  ErrorHandler error_handler{};
-  Lexer lexer{absolute_path, buffer, error_handler};
+  ErrorHandler error_handler{sources};
+  error_handler.SetMaxErrors(max_errors);
+  Arena arena{};
+  InputStream input{stdin};
+  std::optional<TokenCache> token_cache;
+  TokenBuffer cached_tokens;
+  std::vector<ErrorData> cached_errors;
+  if (token_cache_directory && !from_stdin) {
+    token_cache.emplace(*token_cache_directory);
+    token_cache->Tokenize(sources, file_id, cached_tokens, cached_errors);
+  }
+  // the parser has no use for comments
+  LexerOptions lexer_options{.comments = CommentModeDrop};
+  Lexer lexer = from_stdin    ? Lexer{input, sources, file_id, arena, error_handler, lexer_options}
+                : token_cache ? Lexer{cached_tokens, cached_errors, arena, error_handler, lexer_options}
+                              : Lexer{sources, file_id, arena, error_handler, lexer_options};
 
   /*Lexeme lexeme = lexer.Next();
   while (lexeme.Type() != TokenTypeEndOfFile) {
@@ -35,13 +165,26 @@ int main() {
 
     lexeme = lexer.Next();
   }*/
-  Parser parser{absolute_path, lexer, error_handler};
+  Parser parser{file_id, lexer, arena, error_handler};
 
-  parser.Parse();
+  Parser::ParseNode* root = parser.Parse();
+  if (dump_ast) {
+    std::string tree;
+    DumpTree(root, tree);
+    out << tree;
+  }
 
-  if (error_handler.PrintErrors()) {
-    return 1;
+  if (print_stats) {
+    PrintStats(arena, out);
+  }
+  if (token_cache) {
+    std::cerr << "token cache: " << token_cache->Hits() << " hits, " << token_cache->Misses() << " misses"
+              << std::endl;
   }
 
-  return 0;
+  bool has_errors = error_handler.PrintErrors(diagnostics_format, diagnostics_file);
+  if (diagnostics_file != stdout) {
+    std::fclose(diagnostics_file);
+  }
+  return has_errors ? 1 : 0;
 }
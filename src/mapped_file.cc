@@ -0,0 +1,83 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SONO_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  Close();
+  open_ = std::exchange(other.open_, false);
+  mapped_ = std::exchange(other.mapped_, false);
+  size_ = std::exchange(other.size_, 0);
+  fallback_ = std::move(other.fallback_);
+  data_ = mapped_ ? other.data_ : fallback_.data();
+  other.data_ = nullptr;
+  return *this;
+}
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+#ifdef SONO_HAS_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void* data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      ::madvise(data, info.st_size, MADV_SEQUENTIAL);
+      ::close(fd);
+      data_ = static_cast<const char*>(data);
+      size_ = info.st_size;
+      mapped_ = true;
+      open_ = true;
+      return true;
+    }
+  }
+  ::close(fd);
+#endif
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  fallback_ = buffer.str();
+  data_ = fallback_.data();
+  size_ = fallback_.size();
+  open_ = true;
+  return true;
+}
+
+void MappedFile::Close() {
+#ifdef SONO_HAS_MMAP
+  if (mapped_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+  fallback_.clear();
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+  open_ = false;
+}
@@ -0,0 +1,157 @@
+#include "parallel_lexer.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "arena.h"
+#include "diagnostic_engine.h"
+#include "lexer.h"
+#include "simd_scan.h"
+
+namespace {
+
+// Below this many bytes per thread a file is not worth splitting.
+constexpr size_t kMinChunkSize = 64 * 1024;
+
+struct Chunk {
+  uint32_t begin = 0;
+  uint32_t end = 0;
+  TokenBuffer tokens;
+  bool reached_end = false;
+};
+
+void LexChunk(const SourceManager& sources, FileId file_id, Chunk& chunk, ErrorHandler& error_handler) {
+  Arena arena;
+  Lexer lexer{sources, file_id, arena, error_handler};
+  lexer.Seek(chunk.begin);
+  chunk.reached_end = lexer.TokenizeUntil(chunk.tokens, chunk.end);
+}
+
+uint32_t TokenEnd(const TokenBuffer& tokens) {
+  size_t last = tokens.Size() - 1;
+  return tokens.Offset(last) + tokens.Length(last);
+}
+
+}  // namespace
+
+void TokenizeParallel(const SourceManager& sources, FileId file_id, ErrorHandler& error_handler, TokenBuffer& tokens, unsigned thread_count) {
+  std::string_view source = sources.Buffer(file_id);
+  size_t chunk_count = std::min<size_t>(thread_count, source.size() / kMinChunkSize);
+  if (chunk_count <= 1 || error_handler.LimitReached()) {
+    Arena arena;
+    Lexer lexer{sources, file_id, arena, error_handler};
+    lexer.TokenizeAll(tokens);
+    return;
+  }
+
+  // cut right after a newline so chunks start at the beginning of a line
+  std::vector<Chunk> chunks(chunk_count);
+  const char* begin = source.data();
+  const char* end = begin + source.size();
+  const char* cut = begin;
+  for (size_t i = 0; i < chunk_count; ++i) {
+    chunks[i].begin = static_cast<uint32_t>(cut - begin);
+    if (i + 1 == chunk_count) {
+      cut = end;
+    } else {
+      cut = FindNewline(std::max(cut, begin + source.size() * (i + 1) / chunk_count), end);
+      cut = cut == end ? end : cut + 1;
+    }
+    chunks[i].end = static_cast<uint32_t>(cut - begin);
+  }
+
+  // chunk i reports into buffer 2i + 1 and re-lexing it into buffer 2i,
+  // whose errors come first
+  DiagnosticEngine diagnostics{sources, chunk_count * 2};
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < chunk_count; ++i) {
+    workers.emplace_back(LexChunk, std::cref(sources), file_id, std::ref(chunks[i]), std::ref(diagnostics.Buffer(i * 2 + 1)));
+  }
+  LexChunk(sources, file_id, chunks[0], diagnostics.Buffer(1));
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // Stitch the chunks together. A chunk's speculative tokens are only right
+  // if lexing really restarts at its beginning; when the previous token runs
+  // past it, the chunk is re-lexed from the end of that token until a token
+  // starts where a speculative one does, after which both streams agree.
+  // Only the errors of the tokens that are kept stay in the buffers.
+  tokens.SetSource(file_id, source);
+  Arena arena;
+  uint32_t resume = 0;
+  size_t i = 0;
+  for (; i < chunk_count; ++i) {
+    Chunk& chunk = chunks[i];
+    ErrorHandler& chunk_errors = diagnostics.Buffer(i * 2 + 1);
+    size_t first = 0;
+    if (resume > chunk.begin) {
+      ErrorHandler& relex_errors = diagnostics.Buffer(i * 2);
+      Lexer lexer{sources, file_id, arena, relex_errors};
+      lexer.Seek(resume);
+      TokenBuffer relexed;
+      bool synced = false;
+      bool more = true;
+      while (more && !synced) {
+        more = lexer.TokenizeNext(relexed);
+        uint32_t start = relexed.Offset(relexed.Size() - 1);
+        while (first < chunk.tokens.Size() && chunk.tokens.Offset(first) < start) {
+          first++;
+        }
+        synced = first < chunk.tokens.Size() && chunk.tokens.Offset(first) == start;
+        if (!synced && start >= chunk.end) {
+          break;
+        }
+      }
+      size_t keep = synced ? relexed.Size() - 1 : relexed.Size();
+      uint32_t sync_offset = synced ? chunk.tokens.Offset(first) : UINT32_MAX;
+      tokens.Append(relexed, 0, keep);
+      relex_errors.KeepErrors(0, sync_offset);
+      if (!synced) {
+        chunk_errors.TruncateErrors(0);
+        if (!more) {
+          break;
+        }
+        resume = TokenEnd(tokens);
+        continue;
+      }
+    }
+    if (first < chunk.tokens.Size()) {
+      tokens.Append(chunk.tokens, first, chunk.tokens.Size());
+      chunk_errors.KeepErrors(chunk.tokens.Offset(first), UINT32_MAX);
+      resume = TokenEnd(tokens);
+    } else {
+      chunk_errors.TruncateErrors(0);
+    }
+    if (chunk.reached_end) {
+      break;
+    }
+  }
+  // the chunks after the end of file was reached are dropped
+  for (size_t j = (i + 1) * 2; j < chunk_count * 2; ++j) {
+    diagnostics.Buffer(j).TruncateErrors(0);
+  }
+  diagnostics.Merge(error_handler);
+
+  // The chunks were lexed without the error limit, since errors they drop
+  // again must not stop them. Lexer::TokenizeAll stops after the token whose
+  // errors reach the limit, so the tokens behind it are dropped here; the
+  // merge already dropped the errors.
+  if (error_handler.LimitReached()) {
+    uint32_t error_offset = error_handler.Errors().back().location.offset;
+    size_t end_of_file = tokens.Size() - 1;
+    size_t stop = end_of_file;
+    while (stop > 0 && tokens.Offset(stop) > error_offset) {
+      stop--;
+    }
+    if (stop + 1 < end_of_file) {
+      TokenType type = tokens.Type(end_of_file);
+      uint32_t offset = tokens.Offset(end_of_file);
+      uint32_t length = tokens.Length(end_of_file);
+      Symbol value_id = tokens.ValueId(end_of_file);
+      tokens.Truncate(stop + 1);
+      tokens.Push(type, offset, length, value_id);
+    }
+  }
+}
@@ -1,212 +1,464 @@
 #include "parser.h"
 
-Parser::Parser(const std::string& file, Lexer& lexer, ErrorHandler& error_handler)
-    : file_(file),
-      lexer_(lexer),
+#include <array>
+
+namespace {
+
+constexpr std::string_view kParseTypeNames[] = {
+    "Root",
+    "FunctionDecl",
+    "ParamVarDecl",
+    "CompoundStatement",
+    "DeclStatement",
+    "VarDecl",
+    "StringLiteral",
+    "FloatLiteral",
+    "DoubleLiteral",
+    "Int32Literal",
+    "Int64Literal",
+    "CharacterLiteral",
+    "BooleanLiteral",
+    "ImplicitCastExpr",
+    "BinaryOperator",
+    "UnaryOperator",
+    "NullLiteral",
+    "DeclRefExpr",
+    "MemberExpr",
+    "CallExpr",
+    "ReturnStatement",
+};
+
+ParseType LiteralType(TokenType type) {
+  switch (type) {
+    case TokenTypeStringLiteral:
+      return ParseType::StringLiteral;
+    case TokenTypeCharacterLiteral:
+      return ParseType::CharacterLiteral;
+    case TokenTypeNumberFloat:
+      return ParseType::FloatLiteral;
+    case TokenTypeNumberDouble:
+      return ParseType::DoubleLiteral;
+    case TokenTypeNumberInt32:
+      return ParseType::Int32Literal;
+    case TokenTypeNumberInt64:
+      return ParseType::Int64Literal;
+    default:
+      return ParseType::BooleanLiteral;
+  }
+}
+
+// How tightly an operator binds its operands, 0 where it cannot be used that
+// way. An infix operator is left associative when right is above left.
+struct BindingPower {
+  uint8_t prefix;
+  uint8_t left;
+  uint8_t right;
+};
+
+constexpr auto kBindingPowers = [] {
+  std::array<BindingPower, OperatorIdCount> powers{};
+  for (OperatorId id : {OperatorIdAssign, OperatorIdAddAssign, OperatorIdSubtractAssign, OperatorIdMultiplyAssign,
+                        OperatorIdDivideAssign, OperatorIdModuloAssign, OperatorIdXorAssign, OperatorIdAndAssign,
+                        OperatorIdOrAssign, OperatorIdShiftLeftAssign, OperatorIdShiftRightAssign}) {
+    powers[id] = {0, 2, 2};
+  }
+  powers[OperatorIdLogicalOr] = {0, 6, 7};
+  powers[OperatorIdLogicalAnd] = {0, 8, 9};
+  powers[OperatorIdOr] = {0, 10, 11};
+  powers[OperatorIdXor] = {0, 12, 13};
+  powers[OperatorIdAnd] = {0, 14, 15};
+  powers[OperatorIdEqual] = powers[OperatorIdNotEqual] = {0, 16, 17};
+  powers[OperatorIdLess] = powers[OperatorIdGreater] = {0, 18, 19};
+  powers[OperatorIdLessEqual] = powers[OperatorIdGreaterEqual] = {0, 18, 19};
+  powers[OperatorIdShiftLeft] = powers[OperatorIdShiftRight] = {0, 20, 21};
+  powers[OperatorIdAdd] = powers[OperatorIdSubtract] = {26, 22, 23};
+  powers[OperatorIdMultiply] = powers[OperatorIdDivide] = powers[OperatorIdModulo] = {0, 24, 25};
+  for (OperatorId id : {OperatorIdNot, OperatorIdComplement, OperatorIdIncrement, OperatorIdDecrement}) {
+    powers[id] = {26, 0, 0};
+  }
+  return powers;
+}();
+
+}  // namespace
+
+std::string_view ParseTypeName(ParseType type) {
+  return kParseTypeNames[static_cast<size_t>(type)];
+}
+
+Parser::Parser(FileId file_id, Lexer& lexer, Arena& arena, ErrorHandler& error_handler)
+    : file_id_(file_id),
+      tokens_(lexer),
+      arena_(arena),
       error_handler_(error_handler) {
 }
 
 Parser::~Parser() {
 }
 
-std::shared_ptr<Parser::ParseNode> Parser::Parse() {
-  root_ = ParseNode::Create(ParseType::Root, {}, "root");
-  current_node_ = root_;
+Parser::ParseNode* Parser::Parse() {
+  root_ = CreateNode(ParseType::Root, "root", {file_id_, 0});
   do {
-    current_lexeme_ = lexer_.Next();
-    if (current_lexeme_->Type() == TokenTypeEndOfFile) {
+    Next();
+    if (current_lexeme_.Type() == TokenTypeEndOfFile) {
       break;
     }
-    if (current_lexeme_->Type() == TokenTypeComment) {
-      continue;
-    }
-    if (current_lexeme_->Type() == TokenTypeInvalid) {
-      error_handler_.PushError(current_lexeme_->File(), current_lexeme_->Line(), current_lexeme_->LineNumber(), current_lexeme_->CharIndex(), "unexpected invalid token");
+    if (current_lexeme_.Type() == TokenTypeInvalid) {
+      ReportError(current_lexeme_.Location(), DiagnosticIdUnexpectedInvalidToken);
       continue;
     }
     // todo use grammar to parse
-    if (current_lexeme_->Type() == TokenTypeKeyword) {
-      if (current_lexeme_->Value() == "fun") {
-        ParseFunction();
+    if (current_lexeme_.Type() == TokenTypeKeyword) {
+      if (current_lexeme_.Keyword() == KeywordTypeFun) {
+        recovering_ = false;
+        if (ParseNode* function = ParseFunction()) {
+          root_->AddChild(function);
+        }
       }
     }
-//    auto lexeme = *current_lexeme_.get();
-//    std::cout << debugTokenNames[lexeme.Type()] << ": " << lexeme.Value() << std::endl;
-//    std::cout << lexeme.Line() + " (" << lexeme.LineNumber() << ":" << lexeme.CharIndex() << ")" << std::endl;
-/*    for (int i = 0; i < lexeme.CharIndex() - 1; ++i) {
-      std::cout << " ";
-    }
-    std::cout << "^" << std::endl;*/
-  } while (current_lexeme_->Type() != TokenTypeEndOfFile);
+  } while (current_lexeme_.Type() != TokenTypeEndOfFile);
   return root_;
 }
 
-void Parser::ParseFunction() {
-  auto func_name = Next();
-  if (func_name->Type() != TokenTypeIdentifier) {
-    error_handler_.PushError(func_name->File(), func_name->Line(), func_name->LineNumber(), func_name->CharIndex(), "expected function name");
-    return;
+Parser::ParseNode* Parser::ParseFunction() {
+  const Lexeme& name = Next();
+  if (name.Type() != TokenTypeIdentifier) {
+    ReportError(name.Location(), DiagnosticIdExpectedFunctionName);
+    return nullptr;
+  }
+  // a function with a broken signature is left out of the tree
+  ParseNode* function = CreateNode(ParseType::FunctionDecl, name);
+  if (!ParseParameters(function)) {
+    return nullptr;
   }
-  std::cout << "function: " << func_name->Value() << std::endl;
-  ParseParameters();
   Next();
-  if (!CheckPunctuation("{")) {
-    error_handler_.PushError(func_name->File(), func_name->Line(), func_name->LineNumber(), func_name->CharIndex(), "expected left brace");
-    return;
+  if (!CheckPunctuation(OperatorIdLeftBrace)) {
+    ReportError(function->GetData().location_, DiagnosticIdExpectedLeftBrace);
+    return nullptr;
   }
+  function->AddChild(ParseCompoundStatement());
+  return function;
+}
+
+bool Parser::ParseParameters(ParseNode* function) {
+  const Lexeme& open_params = Next();
+  if (!CheckPunctuation(OperatorIdLeftParen)) {
+    ReportError(open_params.Location(), DiagnosticIdExpectedLeftParenthesis);
+    return false;
+  }
+  bool expected_comma = false;
   while (true) {
-    auto statement = Next();
-    if (CheckPunctuation("}")) {
-      break;
+    Next();
+    if (CheckPunctuation(OperatorIdRightParen)) {
+      return true;
+    }
+    if (expected_comma) {
+      if (!CheckPunctuation(OperatorIdComma)) {
+        ReportError(current_lexeme_.Location(), DiagnosticIdExpectedComma);
+        return false;
+      }
+      Next();
+      expected_comma = false;
+    }
+    if (current_lexeme_.Type() != TokenTypeIdentifier) {
+      ReportError(current_lexeme_.Location(), DiagnosticIdExpectedParameterType);
+      return false;
     }
-    ParseStatement();
+    std::string_view param_type = current_lexeme_.Value();
+    const Lexeme& param_name = Next();
+    if (param_name.Type() != TokenTypeIdentifier) {
+      ReportError(param_name.Location(), DiagnosticIdExpectedParameterName);
+      return false;
+    }
+    ParseNode* param = CreateNode(ParseType::ParamVarDecl, param_name);
+    param->GetData().type_ = param_type;
+    function->AddChild(param);
+    expected_comma = true;
   }
 }
 
-void Parser::ParseStatement() {
-  std::vector<std::shared_ptr<Lexeme>> lexemes;
+Parser::ParseNode* Parser::ParseCompoundStatement() {
+  ParseNode* block = CreateNode(ParseType::CompoundStatement, {}, current_lexeme_.Location());
   while (true) {
-    if (current_lexeme_->Type() == TokenTypeEndOfFile) {
-      error_handler_.PushError(current_lexeme_->File(), current_lexeme_->Line(), current_lexeme_->LineNumber(), current_lexeme_->CharIndex(), "unexpected end of file");
-      return;
-    }
-    if (CheckPunctuation(";")) {
+    const Lexeme& next = Peek(0);
+    if (next.Type() == TokenTypeEndOfFile) {
+      ReportError(next.Location(), DiagnosticIdUnexpectedEndOfFile);
       break;
     }
-    lexemes.push_back(current_lexeme_);
     Next();
+    if (CheckPunctuation(OperatorIdRightBrace)) {
+      break;
+    }
+    if (ParseNode* statement = ParseStatement()) {
+      block->AddChild(statement);
+    }
   }
-  if (lexemes.size() == 0) {
-    return;
+  return block;
+}
+
+Parser::ParseNode* Parser::ParseStatement() {
+  if (CheckPunctuation(OperatorIdSemicolon)) {
+    return nullptr;
   }
-  if (lexemes.size() == 1) {
-    error_handler_.PushError(lexemes[0]->File(), lexemes[0]->Line(), lexemes[0]->LineNumber(), lexemes[0]->CharIndex(), "expected statement");
-    return;
+  if (CheckPunctuation(OperatorIdLeftBrace)) {
+    return ParseCompoundStatement();
   }
-  if (lexemes.size() == 6) {
-    // var name: type = value;
-    if (lexemes[0]->Type() == TokenTypeKeyword && lexemes[0]->Value() == "var"
-        && lexemes[1]->Type() == TokenTypeIdentifier && lexemes[3]->Type() == TokenTypeIdentifier
-        && lexemes[4]->Type() == TokenTypeOperator && lexemes[4]->Value() == "="
-        && (lexemes[5]->Type() == TokenTypeIdentifier || IsTokenConstant(lexemes[5]->Type()))) {
-      std::cout << "var declaration: " << lexemes[1]->Value() << " with type " << lexemes[3]->Value() << std::endl;
-      std::cout << "assignment: " << lexemes[1]->Value() << " = " << lexemes[5]->Value() << " <- " << debugTokenNames[lexemes[5]->Type()] << std::endl;
-      return;
-    }
-  } else if (lexemes.size() == 4) {
-    if (lexemes[0]->Type() == TokenTypeKeyword && lexemes[0]->Value() == "var"
-        && lexemes[1]->Type() == TokenTypeIdentifier && lexemes[3]->Type() == TokenTypeIdentifier) {
-      std::cout << "var declaration: " << lexemes[1]->Value() << " " << lexemes[3]->Value() << std::endl;
-      return;
+  if (current_lexeme_.Type() == TokenTypeKeyword) {
+    if (current_lexeme_.Keyword() == KeywordTypeVar) {
+      return ParseVarDeclaration();
     }
-  } else if (lexemes.size() == 3) {
-    if (lexemes[0]->Type() == TokenTypeIdentifier && lexemes[1]->Type() == TokenTypeOperator && lexemes[1]->Value() == "="
-        && (lexemes[2]->Type() == TokenTypeIdentifier || IsTokenConstant(lexemes[2]->Type()))) {
-      std::cout << "assignment: " << lexemes[0]->Value() << " = " << lexemes[2]->Value() << std::endl;
-      return;
+    if (current_lexeme_.Keyword() == KeywordTypeReturn) {
+      return ParseReturn();
     }
   }
+  if (current_lexeme_.Type() == TokenTypeIdentifier && Peek(0).Type() == TokenTypeIdentifier) {
+    return ParseTypedDeclaration();
+  }
+  ParseNode* expression = ParseExpression();
+  if (expression == nullptr) {
+    SkipStatement();
+    return nullptr;
+  }
+  return ExpectSemicolon() ? expression : nullptr;
+}
 
-  if (CheckPunctuation(lexemes[lexemes.size() - 1], ")")) {
-    // function call
-    std::vector<std::string> identifiers;
-    std::string full_call;
-    bool dot = false;
-    int start_index = 0;
-    for (int i = 0; i < lexemes.size(); ++i) {
-      const auto& item = lexemes[i];
-      if (CheckPunctuation(item, "(")) {
-        start_index = i;
-        break;
-      }
-      if (dot) {
-        if (CheckPunctuation(item, ".")) {
-          full_call += item->Value();
-        } else {
-          error_handler_.PushError(item->File(), item->Line(), item->LineNumber(), item->CharIndex(), "unexpected punctuation");
-        }
-        dot = false;
-      }
+Parser::ParseNode* Parser::ParseVarDeclaration() {
+  // var name: type = value;
+  if (Peek(0).Type() != TokenTypeIdentifier) {
+    ReportError(Peek(0).Location(), DiagnosticIdExpectedVariableName);
+    SkipStatement();
+    return nullptr;
+  }
+  ParseNode* var = CreateNode(ParseType::VarDecl, Next());
+  if (!Accept(OperatorIdColon) || Peek(0).Type() != TokenTypeIdentifier) {
+    ReportError(Peek(0).Location(), DiagnosticIdExpectedTypeName);
+    SkipStatement();
+    return nullptr;
+  }
+  var->GetData().type_ = Next().Value();
+  return FinishDeclaration(var);
+}
 
-      if (item->Type() == TokenTypeIdentifier) {
-        identifiers.push_back(item->Value());
-        full_call += item->Value();
-        dot = true;
-      }
-    }
+Parser::ParseNode* Parser::ParseTypedDeclaration() {
+  // type name = value;
+  std::string_view type = current_lexeme_.Value();
+  ParseNode* var = CreateNode(ParseType::VarDecl, Next());
+  var->GetData().type_ = type;
+  return FinishDeclaration(var);
+}
 
-    const auto& last_lexeme = lexemes[lexemes.size() - 1];
-    if (start_index == 0) {
-      error_handler_.PushError(last_lexeme->File(), last_lexeme->Line(), last_lexeme->LineNumber(), last_lexeme->CharIndex(), "expected open paranthesis");
-      return;
+Parser::ParseNode* Parser::FinishDeclaration(ParseNode* var) {
+  if (Peek(0).Operator() == OperatorIdAssign) {
+    Next();
+    Next();
+    ParseNode* value = ParseExpression();
+    if (value == nullptr) {
+      SkipStatement();
+      return nullptr;
     }
-    std::cout << "function call: " << full_call << std::endl;
-    for (int i = start_index + 1, j = 0; i < lexemes.size() - 1; ++i, j++) {
-      const auto& item = lexemes[i];
-      if (j % 2 == 1) {
-        if (!CheckPunctuation(item, ",")) {
-          error_handler_.PushError(item->File(), item->Line(), item->LineNumber(), item->CharIndex(), "expected comma");
-          break;
-        }
-        continue;
-      }
+    var->AddChild(value);
+  }
+  if (!ExpectSemicolon()) {
+    return nullptr;
+  }
+  ParseNode* statement = CreateNode(ParseType::DeclStatement, {}, var->GetData().location_);
+  statement->AddChild(var);
+  return statement;
+}
 
-      if (lexemes[2]->Type() == TokenTypeIdentifier || IsTokenConstant(lexemes[2]->Type())) {
-        std::cout << "param: " << item->Value() << std::endl;
-      }
-    }
-    if (!CheckPunctuation(last_lexeme, ")")) {
-      error_handler_.PushError(last_lexeme->File(), last_lexeme->Line(), last_lexeme->LineNumber(), last_lexeme->CharIndex(), "expected close parenthesis");
-      return;
+Parser::ParseNode* Parser::ParseReturn() {
+  ParseNode* statement = CreateNode(ParseType::ReturnStatement, {}, current_lexeme_.Location());
+  if (!CheckPunctuation(Peek(0), OperatorIdSemicolon)) {
+    Next();
+    ParseNode* value = ParseExpression();
+    if (value == nullptr) {
+      SkipStatement();
+      return nullptr;
     }
+    statement->AddChild(value);
   }
+  return ExpectSemicolon() ? statement : nullptr;
 }
 
-void Parser::ParseParameters() {
-  auto open_params = Next();
-  if (!CheckPunctuation("(")) {
-    error_handler_.PushError(open_params->File(), open_params->Line(), open_params->LineNumber(), open_params->CharIndex(), "expected left parenthesis");
-    return;
+Parser::ParseNode* Parser::ParseExpression(int min_power) {
+  ParseNode* left;
+  int prefix_power = current_lexeme_.Type() == TokenTypeOperator ? kBindingPowers[current_lexeme_.Operator()].prefix : 0;
+  if (prefix_power != 0) {
+    left = CreateNode(ParseType::UnaryOperator, current_lexeme_);
+    Next();
+    ParseNode* operand = ParseExpression(prefix_power);
+    if (operand == nullptr) {
+      return nullptr;
+    }
+    left->AddChild(operand);
+  } else {
+    left = ParsePostfix();
+    if (left == nullptr) {
+      return nullptr;
+    }
   }
-  bool expected_comma = false;
+  // operators that bind looser than min_power belong to an enclosing call
   while (true) {
-    auto param_type = Next();
-    if (CheckPunctuation(")")) {
+    const Lexeme& next = Peek(0);
+    if (next.Type() != TokenTypeOperator) {
       break;
     }
-    if (expected_comma) {
-      auto comma = param_type;
-      if (!CheckPunctuation(",")) {
-        error_handler_.PushError(comma->File(), comma->Line(), comma->LineNumber(), comma->CharIndex(), "expected comma");
-        break;
-      }
-      param_type = Next();
-      expected_comma = false;
-    }
-    if (param_type->Type() != TokenTypeIdentifier) {
-      error_handler_.PushError(param_type->File(), param_type->Line(), param_type->LineNumber(), param_type->CharIndex(), "expected parameter type");
+    BindingPower power = kBindingPowers[next.Operator()];
+    if (power.left == 0 || power.left < min_power) {
       break;
     }
-    auto param_name = Next();
-    if (param_name->Type() != TokenTypeIdentifier) {
-      error_handler_.PushError(param_type->File(), param_name->Line(), param_name->LineNumber(), param_name->CharIndex(), "expected parameter name");
+    ParseNode* binary = CreateNode(ParseType::BinaryOperator, Next());
+    Next();
+    ParseNode* right = ParseExpression(power.right);
+    if (right == nullptr) {
+      return nullptr;
+    }
+    binary->AddChild(left);
+    binary->AddChild(right);
+    left = binary;
+  }
+  return left;
+}
+
+Parser::ParseNode* Parser::ParsePostfix() {
+  ParseNode* expression = ParsePrimary();
+  while (expression != nullptr) {
+    if (Accept(OperatorIdDot)) {
+      if (Peek(0).Type() != TokenTypeIdentifier) {
+        ReportError(Peek(0).Location(), DiagnosticIdExpectedMemberName);
+        return nullptr;
+      }
+      ParseNode* member = CreateNode(ParseType::MemberExpr, Next());
+      member->AddChild(expression);
+      expression = member;
+    } else if (Accept(OperatorIdLeftParen)) {
+      ParseNode* call = CreateNode(ParseType::CallExpr, {}, current_lexeme_.Location());
+      call->AddChild(expression);
+      expression = call;
+      if (Accept(OperatorIdRightParen)) {
+        continue;
+      }
+      while (true) {
+        Next();
+        ParseNode* argument = ParseExpression();
+        if (argument == nullptr) {
+          return nullptr;
+        }
+        call->AddChild(argument);
+        if (Accept(OperatorIdRightParen)) {
+          break;
+        }
+        if (!Accept(OperatorIdComma)) {
+          ReportError(Peek(0).Location(), DiagnosticIdExpectedComma);
+          return nullptr;
+        }
+      }
+    } else if (Peek(0).Operator() == OperatorIdIncrement || Peek(0).Operator() == OperatorIdDecrement) {
+      ParseNode* unary = CreateNode(ParseType::UnaryOperator, Next());
+      unary->AddChild(expression);
+      expression = unary;
+    } else {
       break;
     }
-    expected_comma = true;
-    std::cout << "parameter: " << param_type->Value() << " " << param_name->Value() << std::endl;
   }
+  return expression;
 }
 
-bool Parser::CheckPunctuation(const std::string& value) {
-  if (current_lexeme_->Type() == TokenTypePunctuation && current_lexeme_->Value() == value) {
-    return true;
+Parser::ParseNode* Parser::ParsePrimary() {
+  TokenType type = current_lexeme_.Type();
+  if (IsTokenConstant(type)) {
+    return CreateNode(LiteralType(type), current_lexeme_);
   }
-  return false;
+  if (type == TokenTypeIdentifier) {
+    return CreateNode(ParseType::DeclRefExpr, current_lexeme_);
+  }
+  if (type == TokenTypeKeyword) {
+    switch (current_lexeme_.Keyword()) {
+      case KeywordTypeTrue:
+      case KeywordTypeFalse:
+        return CreateNode(ParseType::BooleanLiteral, current_lexeme_);
+      case KeywordTypeNull:
+        return CreateNode(ParseType::NullLiteral, current_lexeme_);
+      default:
+        break;
+    }
+  }
+  if (CheckPunctuation(OperatorIdLeftParen)) {
+    Next();
+    ParseNode* expression = ParseExpression();
+    if (expression != nullptr && !Accept(OperatorIdRightParen)) {
+      ReportError(Peek(0).Location(), DiagnosticIdExpectedCloseParenthesis);
+      return nullptr;
+    }
+    return expression;
+  }
+  ReportError(current_lexeme_.Location(), DiagnosticIdExpectedExpression);
+  return nullptr;
 }
 
-bool Parser::CheckPunctuation(std::shared_ptr<Lexeme> lexeme, const std::string& value) {
-  if (lexeme->Type() == TokenTypePunctuation && lexeme->Value() == value) {
+bool Parser::ExpectSemicolon() {
+  if (Accept(OperatorIdSemicolon)) {
+    recovering_ = false;
     return true;
   }
+  ReportError(Peek(0).Location(), DiagnosticIdExpectedSemicolon);
+  SkipStatement();
   return false;
-}
\ No newline at end of file
+}
+
+void Parser::SkipStatement() {
+  while (!CheckPunctuation(OperatorIdSemicolon)) {
+    const Lexeme& next = Peek(0);
+    if (CheckPunctuation(next, OperatorIdRightBrace) || next.Type() == TokenTypeEndOfFile) {
+      return;
+    }
+    Next();
+  }
+  recovering_ = false;
+}
+
+void Parser::ReportError(SourceLocation location, DiagnosticId id) {
+  if (recovering_) {
+    return;
+  }
+  recovering_ = true;
+  error_handler_.PushError(location, id);
+}
+
+Parser::ParseNode* Parser::CreateNode(ParseType type, std::string_view value, SourceLocation location) {
+  node_count_++;
+  return ParseNode::Create(arena_, type, {value, {}, location}, value);
+}
+
+bool Parser::Accept(OperatorId id) {
+  if (!CheckPunctuation(Peek(0), id)) {
+    return false;
+  }
+  Next();
+  return true;
+}
+
+bool Parser::CheckPunctuation(OperatorId id) {
+  return CheckPunctuation(current_lexeme_, id);
+}
+
+bool Parser::CheckPunctuation(const Lexeme& lexeme, OperatorId id) {
+  return lexeme.Type() == TokenTypePunctuation && lexeme.Operator() == id;
+}
+
+void DumpTree(const Parser::ParseNode* node, std::string& out, int depth) {
+  const ParseData& data = node->GetData();
+  out.append(depth * 2, ' ');
+  out += ParseTypeName(node->GetType());
+  if (!data.value_.empty()) {
+    out += ' ';
+    out += data.value_;
+  }
+  if (!data.type_.empty()) {
+    out += ": ";
+    out += data.type_;
+  }
+  out += '\n';
+  for (auto* child = node->GetFirstChild(); child != nullptr; child = child->GetNextSibling()) {
+    DumpTree(child, out, depth + 1);
+  }
+}
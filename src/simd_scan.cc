@@ -0,0 +1,360 @@
+#include "simd_scan.h"
+
+#include <cstdint>
+#include <cstring>
+#include "char_class.h"
+#include "utf8.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define SONO_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char* SkipWhitespaceScalar(const char* p, const char* end) {
+  while (p != end && IsEmpty(*p)) {
+    p++;
+  }
+  return p;
+}
+
+const char* FindNewlineScalar(const char* p, const char* end) {
+  const void* found = std::memchr(p, '\n', end - p);
+  return found ? static_cast<const char*>(found) : end;
+}
+
+const char* FindCommentEndScalar(const char* p, const char* end) {
+  while (end - p >= 2) {
+    if (p[0] == '*' && p[1] == '/') {
+      return p;
+    }
+    p++;
+  }
+  return end;
+}
+
+const char* FindStringEndScalar(const char* p, const char* end) {
+  while (p != end && *p != '"' && *p != '\\' && *p != '\n') {
+    p++;
+  }
+  return p;
+}
+
+const char* FindInvalidUtf8Scalar(const char* p, const char* end) {
+  while (p != end) {
+    uint64_t word;
+    if (end - p >= 8 && (std::memcpy(&word, p, 8), (word & 0x8080808080808080) == 0)) {
+      p += 8;
+      continue;
+    }
+    char32_t code_point;
+    int length = DecodeUtf8(p, end, code_point);
+    if (length == 0) {
+      return p;
+    }
+    p += length;
+  }
+  return end;
+}
+
+#ifdef SONO_SCAN_X86
+
+// Sets every byte of the result whose value lies in [lo, hi].
+inline __m128i InRange(__m128i v, char lo, char hi) {
+  __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_subs_epu8(offset, _mm_set1_epi8(hi - lo)), _mm_setzero_si128());
+}
+
+inline __m128i WhitespaceMask(__m128i v) {
+  return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), InRange(v, '\t', '\r'));
+}
+
+inline __m128i Load16(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+const char* SkipWhitespaceSse2(const char* p, const char* end) {
+  for (; end - p >= 16; p += 16) {
+    unsigned stop = ~_mm_movemask_epi8(WhitespaceMask(Load16(p))) & 0xFFFF;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+  return SkipWhitespaceScalar(p, end);
+}
+
+const char* FindNewlineSse2(const char* p, const char* end) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; end - p >= 16; p += 16) {
+    unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(Load16(p), newline));
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindNewlineScalar(p, end);
+}
+
+const char* FindCommentEndSse2(const char* p, const char* end) {
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i slash = _mm_set1_epi8('/');
+  for (; end - p >= 17; p += 16) {
+    __m128i stars = _mm_cmpeq_epi8(Load16(p), star);
+    __m128i slashes = _mm_cmpeq_epi8(Load16(p + 1), slash);
+    unsigned found = _mm_movemask_epi8(_mm_and_si128(stars, slashes));
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindCommentEndScalar(p, end);
+}
+
+const char* FindStringEndSse2(const char* p, const char* end) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; end - p >= 16; p += 16) {
+    __m128i v = Load16(p);
+    __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                _mm_cmpeq_epi8(v, newline));
+    unsigned found = _mm_movemask_epi8(stop);
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindStringEndScalar(p, end);
+}
+
+const char* FindInvalidUtf8Sse2(const char* p, const char* end) {
+  while (end - p >= 16) {
+    unsigned high = _mm_movemask_epi8(Load16(p));
+    if (high == 0) {
+      p += 16;
+      continue;
+    }
+    p += __builtin_ctz(high);
+    char32_t code_point;
+    int length = DecodeUtf8(p, end, code_point);
+    if (length == 0) {
+      return p;
+    }
+    p += length;
+  }
+  return FindInvalidUtf8Scalar(p, end);
+}
+
+#define SONO_AVX2 __attribute__((target("avx2")))
+
+SONO_AVX2 inline __m256i InRange(__m256i v, char lo, char hi) {
+  __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_subs_epu8(offset, _mm256_set1_epi8(hi - lo)), _mm256_setzero_si256());
+}
+
+SONO_AVX2 inline __m256i Load32(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+SONO_AVX2 const char* SkipWhitespaceAvx2(const char* p, const char* end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i v = Load32(p);
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), InRange(v, '\t', '\r'));
+    unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(space));
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+  return SkipWhitespaceSse2(p, end);
+}
+
+SONO_AVX2 const char* FindNewlineAvx2(const char* p, const char* end) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  for (; end - p >= 32; p += 32) {
+    unsigned found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(Load32(p), newline));
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindNewlineSse2(p, end);
+}
+
+SONO_AVX2 const char* FindCommentEndAvx2(const char* p, const char* end) {
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i slash = _mm256_set1_epi8('/');
+  for (; end - p >= 33; p += 32) {
+    __m256i stars = _mm256_cmpeq_epi8(Load32(p), star);
+    __m256i slashes = _mm256_cmpeq_epi8(Load32(p + 1), slash);
+    unsigned found = _mm256_movemask_epi8(_mm256_and_si256(stars, slashes));
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindCommentEndSse2(p, end);
+}
+
+SONO_AVX2 const char* FindStringEndAvx2(const char* p, const char* end) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  for (; end - p >= 32; p += 32) {
+    __m256i v = Load32(p);
+    __m256i stop = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                   _mm256_cmpeq_epi8(v, newline));
+    unsigned found = _mm256_movemask_epi8(stop);
+    if (found != 0) {
+      return p + __builtin_ctz(found);
+    }
+  }
+  return FindStringEndSse2(p, end);
+}
+
+// The last n bytes of previous followed by the first 32 - n of input.
+template <int N>
+SONO_AVX2 inline __m256i PreviousBytes(__m256i input, __m256i previous) {
+  return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+SONO_AVX2 inline __m256i HighNibbles(__m256i v) {
+  return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+// Keiser and Lemire's lookup validation: each pair of adjacent bytes is
+// classified through three nibble lookups whose intersection is non-zero for
+// every error a pair can show, and the expected continuation bytes of three
+// and four byte sequences are checked separately. Returns non-zero bytes
+// where input, following previous, is not valid UTF-8.
+SONO_AVX2 inline __m256i Utf8Errors(__m256i input, __m256i previous) {
+  constexpr char kTooShort = 1 << 0;
+  constexpr char kTooLong = 1 << 1;
+  constexpr char kOverlong3 = 1 << 2;
+  constexpr char kTooLarge = 1 << 3;
+  constexpr char kSurrogate = 1 << 4;
+  constexpr char kOverlong2 = 1 << 5;
+  constexpr char kTooLarge1000 = 1 << 6;
+  constexpr char kOverlong4 = 1 << 6;
+  constexpr char kTwoConts = static_cast<char>(1 << 7);
+  constexpr char kCarry = kTooShort | kTooLong | kTwoConts;
+  constexpr char kLarge = kCarry | kTooLarge | kTooLarge1000;
+
+  __m256i previous1 = PreviousBytes<1>(input, previous);
+  const __m256i byte1_high_table = _mm256_setr_epi8(
+      kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      kTooShort | kOverlong2, kTooShort, kTooShort | kOverlong3 | kSurrogate,
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+      kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      kTooShort | kOverlong2, kTooShort, kTooShort | kOverlong3 | kSurrogate,
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4);
+  const __m256i byte1_low_table = _mm256_setr_epi8(
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry,
+      kCarry | kTooLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge,
+      kLarge | kSurrogate, kLarge, kLarge,
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry,
+      kCarry | kTooLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge, kLarge,
+      kLarge | kSurrogate, kLarge, kLarge);
+  constexpr char kCont1000 = kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4;
+  constexpr char kCont1001 = kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge;
+  constexpr char kCont101 = kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge;
+  const __m256i byte2_high_table = _mm256_setr_epi8(
+      kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+      kCont1000, kCont1001, kCont101, kCont101, kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+      kCont1000, kCont1001, kCont101, kCont101, kTooShort, kTooShort, kTooShort, kTooShort);
+  __m256i byte1_high = _mm256_shuffle_epi8(byte1_high_table, HighNibbles(previous1));
+  __m256i byte1_low = _mm256_shuffle_epi8(byte1_low_table, _mm256_and_si256(previous1, _mm256_set1_epi8(0x0F)));
+  __m256i byte2_high = _mm256_shuffle_epi8(byte2_high_table, HighNibbles(input));
+  __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte1_high, byte1_low), byte2_high);
+
+  // bytes two after a three or four byte lead, or three after a four byte
+  // lead, must be continuations
+  __m256i third = _mm256_subs_epu8(PreviousBytes<2>(input, previous), _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(PreviousBytes<3>(input, previous), _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+  return _mm256_xor_si256(must_continue, special_cases);
+}
+
+SONO_AVX2 const char* FindInvalidUtf8Avx2(const char* p, const char* end) {
+  const char* begin = p;
+  // the last three bytes of a block that start a sequence the next block
+  // has to finish
+  const __m256i incomplete_limit = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, static_cast<char>(0xF0 - 1),
+      static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+  __m256i previous = _mm256_setzero_si256();
+  __m256i incomplete = _mm256_setzero_si256();
+  for (; end - p >= 32; p += 32) {
+    __m256i input = Load32(p);
+    __m256i errors;
+    if (_mm256_movemask_epi8(input) == 0) {
+      errors = incomplete;
+      incomplete = _mm256_setzero_si256();
+    } else {
+      errors = Utf8Errors(input, previous);
+      incomplete = _mm256_subs_epu8(input, incomplete_limit);
+    }
+    if (!_mm256_testz_si256(errors, errors)) {
+      break;
+    }
+    previous = input;
+  }
+  // The rest, or the block with the error, is checked one sequence at a
+  // time, starting with the sequence that may reach into it.
+  const char* start = p;
+  while (start != begin && p - start < 3 && IsUtf8Continuation(start[-1])) {
+    start--;
+  }
+  if (start != begin && p - start < 4 && static_cast<unsigned char>(start[-1]) >= 0xC0) {
+    start--;
+  }
+  return FindInvalidUtf8Sse2(start, end);
+}
+
+#undef SONO_AVX2
+
+#endif  // SONO_SCAN_X86
+
+const ScanKernels kScalarKernels = {
+    "scalar",
+    SkipWhitespaceScalar,
+    FindNewlineScalar,
+    FindCommentEndScalar,
+    FindStringEndScalar,
+    FindInvalidUtf8Scalar,
+};
+
+#ifdef SONO_SCAN_X86
+const ScanKernels kSse2Kernels = {
+    "sse2",
+    SkipWhitespaceSse2,
+    FindNewlineSse2,
+    FindCommentEndSse2,
+    FindStringEndSse2,
+    FindInvalidUtf8Sse2,
+};
+
+const ScanKernels kAvx2Kernels = {
+    "avx2",
+    SkipWhitespaceAvx2,
+    FindNewlineAvx2,
+    FindCommentEndAvx2,
+    FindStringEndAvx2,
+    FindInvalidUtf8Avx2,
+};
+#endif
+
+const ScanKernels& SelectScanKernels() {
+#ifdef SONO_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return kAvx2Kernels;
+  }
+  return kSse2Kernels;
+#else
+  return kScalarKernels;
+#endif
+}
+
+}  // namespace
+
+const ScanKernels& kScanKernels = SelectScanKernels();
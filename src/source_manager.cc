@@ -0,0 +1,181 @@
+#include "source_manager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "utf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SONO_HAS_SSE2 1
+#endif
+
+namespace {
+
+// Appends the offset following every '\n' in data to line_starts. Source
+// files have short lines, so instead of calling memchr once per line this
+// compares 16 bytes at a time and walks the resulting bit mask.
+void IndexLineStarts(std::string_view data, std::vector<uint32_t>& line_starts) {
+  const char* begin = data.data();
+  const char* end = begin + data.size();
+  const char* p = begin;
+#ifdef SONO_HAS_SSE2
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+    while (mask != 0) {
+      unsigned bit = __builtin_ctz(mask);
+      line_starts.push_back(static_cast<uint32_t>(p - begin) + bit + 1);
+      mask &= mask - 1;
+    }
+  }
+#endif
+  while (p != end) {
+    const char* found = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (found == nullptr) {
+      break;
+    }
+    line_starts.push_back(static_cast<uint32_t>(found - begin) + 1);
+    p = found + 1;
+  }
+}
+
+}  // namespace
+
+SourceManager::SourceManager() {
+}
+
+SourceManager::~SourceManager() {
+}
+
+FileId SourceManager::AddFile(const std::string& path) {
+  auto entry = std::make_unique<Entry>();
+  if (!entry->file.Open(path)) {
+    return kInvalidFileId;
+  }
+  entry->name = std::filesystem::absolute(path).string();
+  entry->data = entry->file.Data();
+  return AddEntry(std::move(entry));
+}
+
+FileId SourceManager::AddBuffer(const std::string& name, std::string contents) {
+  auto entry = std::make_unique<Entry>();
+  entry->name = name;
+  entry->contents = std::move(contents);
+  entry->data = entry->contents;
+  return AddEntry(std::move(entry));
+}
+
+FileId SourceManager::AddStream(const std::string& name) {
+  auto entry = std::make_unique<Entry>();
+  entry->name = name;
+  entry->streamed = true;
+  return AddEntry(std::move(entry));
+}
+
+void SourceManager::SetStreamWindow(FileId file_id, std::string_view window, uint32_t base, int line_number, uint32_t line_start,
+                                    int line_columns) {
+  Entry& entry = *files_[file_id];
+  entry.window = {window, base, line_number, line_start, line_columns};
+  // complete the notes whose line continued past the previous window
+  for (auto it = entry.line_notes.rbegin(); it != entry.line_notes.rend() && it->open; ++it) {
+    if (it->line_end < base) {
+      it->open = false;
+      continue;
+    }
+    std::string_view rest = window.substr(it->line_end - base);
+    size_t newline = rest.find('\n');
+    it->open = newline == std::string_view::npos;
+    rest = rest.substr(0, newline);
+    it->line.append(rest);
+    it->line_end += static_cast<uint32_t>(rest.size());
+  }
+}
+
+void SourceManager::NoteLine(SourceLocation location) const {
+  const Entry& entry = *files_[location.file_id];
+  if (!entry.streamed) {
+    return;
+  }
+  const StreamWindow& window = entry.window;
+  if (location.offset < window.base || location.offset > window.base + window.data.size()) {
+    return;
+  }
+  std::string_view before = window.data.substr(0, location.offset - window.base);
+  int line_number = window.line_number + static_cast<int>(std::count(before.begin(), before.end(), '\n'));
+  size_t newline = before.rfind('\n');
+  uint32_t line_start = newline == std::string_view::npos ? window.line_start : window.base + newline + 1;
+  uint32_t visible_start = std::max(line_start, window.base);
+  std::string_view text = window.data.substr(visible_start - window.base);
+  size_t line_end = text.find('\n', location.offset - visible_start);
+  bool open = line_end == std::string_view::npos;
+  text = text.substr(0, line_end);
+
+  // the line may have started in an earlier window
+  int skipped_columns = line_start < window.base ? window.line_columns : 0;
+  int char_index = skipped_columns + 1 +
+                   static_cast<int>(CountCodePoints(window.data.substr(visible_start - window.base,
+                                                                       location.offset - visible_start)));
+  LineNote note{location.offset,
+                line_number,
+                char_index,
+                static_cast<int>(location.offset - line_start) + 1,
+                std::string(text),
+                static_cast<uint32_t>(text.data() + text.size() - window.data.data()) + window.base,
+                open,
+                skipped_columns};
+  auto& notes = entry.line_notes;
+  auto it = std::lower_bound(notes.begin(), notes.end(), location.offset,
+                             [](const LineNote& note, uint32_t offset) { return note.offset < offset; });
+  if (it != notes.end() && it->offset == location.offset) {
+    *it = std::move(note);
+  } else {
+    notes.insert(it, std::move(note));
+  }
+}
+
+FileId SourceManager::AddEntry(std::unique_ptr<Entry> entry) {
+  files_.push_back(std::move(entry));
+  return static_cast<FileId>(files_.size() - 1);
+}
+
+const std::vector<uint32_t>& SourceManager::LineStarts(FileId file_id) const {
+  const Entry& entry = *files_[file_id];
+  if (entry.line_starts.empty()) {
+    // assume ~32 bytes per line to avoid regrowing the table on large inputs
+    entry.line_starts.reserve(entry.data.size() / 32 + 1);
+    entry.line_starts.push_back(0);
+    IndexLineStarts(entry.data, entry.line_starts);
+  }
+  return entry.line_starts;
+}
+
+void SourceManager::SetLineStarts(FileId file_id, std::vector<uint32_t> line_starts) {
+  files_[file_id]->line_starts = std::move(line_starts);
+}
+
+LineInfo SourceManager::GetLineInfo(SourceLocation location) const {
+  const Entry& entry = *files_[location.file_id];
+  if (entry.streamed) {
+    const auto& notes = entry.line_notes;
+    auto it = std::lower_bound(notes.begin(), notes.end(), location.offset,
+                               [](const LineNote& note, uint32_t offset) { return note.offset < offset; });
+    if (it == notes.end() || it->offset != location.offset) {
+      return {0, 0, 0, {}};
+    }
+    return {it->line_number, it->char_index, it->byte_index, it->line, it->skipped_columns};
+  }
+  const auto& starts = LineStarts(location.file_id);
+  auto it = std::upper_bound(starts.begin(), starts.end(), location.offset);
+  size_t line_index = (it - starts.begin()) - 1;
+  uint32_t line_start = starts[line_index];
+  uint32_t line_end = line_index + 1 < starts.size() ? starts[line_index + 1] - 1 : entry.data.size();
+
+  LineInfo info;
+  info.line_number = static_cast<int>(line_index) + 1;
+  info.char_index = static_cast<int>(CountCodePoints(entry.data.substr(line_start, location.offset - line_start))) + 1;
+  info.byte_index = static_cast<int>(location.offset - line_start) + 1;
+  info.line = entry.data.substr(line_start, line_end - line_start);
+  return info;
+}
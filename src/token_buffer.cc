@@ -0,0 +1,191 @@
+#include "token_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+void TokenBuffer::Clear() {
+  gap_begin_ = kNoGap;
+  gap_size_ = 0;
+  tail_base_ = 0;
+  types_.clear();
+  offsets_.clear();
+  lengths_.clear();
+  value_ids_.clear();
+  constants_.clear();
+  trivia_.clear();
+}
+
+void TokenBuffer::Truncate(size_t count) {
+  if (gap_begin_ != kNoGap) {
+    CloseGap();
+  }
+  types_.resize(count);
+  offsets_.resize(count);
+  lengths_.resize(count);
+  value_ids_.resize(count);
+  while (!trivia_.empty() && trivia_.back().token >= count) {
+    trivia_.pop_back();
+  }
+}
+
+SourceRange TokenBuffer::Trivia(size_t i) const {
+  auto it = std::lower_bound(trivia_.begin(), trivia_.end(), i,
+                             [](const TriviaEntry& entry, size_t token) { return entry.token < token; });
+  return it != trivia_.end() && it->token == i ? it->range : SourceRange{};
+}
+
+void TokenBuffer::Append(const TokenBuffer& other, size_t first, size_t last) {
+  if (gap_begin_ != kNoGap) {
+    CloseGap();
+  }
+  // Numbers lexed in one pass have consecutive constants, which are copied as
+  // a block with their indices moved by the same amount. Splice adds the
+  // constants of replacement numbers at the end of the pool, so the numbers of
+  // an edited buffer are copied one by one.
+  size_t first_constant = SIZE_MAX;
+  size_t last_constant = 0;
+  bool consecutive = other.gap_begin_ >= last;
+  for (size_t i = first; consecutive && i < last; ++i) {
+    if (IsTokenNumber(other.Type(i))) {
+      size_t id = other.ValueId(i);
+      consecutive = first_constant == SIZE_MAX || id == last_constant;
+      first_constant = std::min(first_constant, id);
+      last_constant = std::max(last_constant, id + 1);
+    }
+  }
+  if (!consecutive) {
+    for (size_t i = first; i < last; ++i) {
+      Symbol value_id = IsTokenNumber(other.Type(i)) ? AddConstant(other.Number(i)) : other.ValueId(i);
+      if (SourceRange trivia = other.Trivia(i); trivia.length != 0) {
+        PushTrivia(trivia);
+      }
+      Push(other.Type(i), other.Offset(i), other.Length(i), value_id);
+    }
+    return;
+  }
+  for (const TriviaEntry& entry : other.trivia_) {
+    if (entry.token >= first && entry.token < last) {
+      trivia_.push_back({static_cast<uint32_t>(Size() + entry.token - first), entry.range});
+    }
+  }
+  types_.insert(types_.end(), other.types_.begin() + first, other.types_.begin() + last);
+  lengths_.insert(lengths_.end(), other.lengths_.begin() + first, other.lengths_.begin() + last);
+  offsets_.insert(offsets_.end(), other.offsets_.begin() + first, other.offsets_.begin() + last);
+  size_t value_base = value_ids_.size();
+  value_ids_.insert(value_ids_.end(), other.value_ids_.begin() + first, other.value_ids_.begin() + last);
+  if (first_constant == SIZE_MAX) {
+    return;
+  }
+  uint32_t constant_shift = static_cast<uint32_t>(constants_.size() - first_constant);
+  constants_.insert(constants_.end(), other.constants_.begin() + first_constant, other.constants_.begin() + last_constant);
+  for (size_t i = value_base; i < value_ids_.size(); ++i) {
+    if (IsTokenNumber(static_cast<TokenType>(types_[i]))) {
+      value_ids_[i] += constant_shift;
+    }
+  }
+}
+
+void TokenBuffer::Splice(size_t first, size_t last, const TokenBuffer& replacement, int64_t shift) {
+  size_t count = replacement.Size();
+  std::vector<TriviaEntry> trivia;
+  for (const TriviaEntry& entry : trivia_) {
+    if (entry.token < first) {
+      trivia.push_back(entry);
+    }
+  }
+  for (const TriviaEntry& entry : replacement.trivia_) {
+    trivia.push_back({static_cast<uint32_t>(first + entry.token), entry.range});
+  }
+  for (const TriviaEntry& entry : trivia_) {
+    if (entry.token >= last) {
+      SourceRange range{static_cast<uint32_t>(entry.range.offset + shift), entry.range.length};
+      trivia.push_back({static_cast<uint32_t>(entry.token - last + first + count), range});
+    }
+  }
+  trivia_ = std::move(trivia);
+
+  // the replaced tokens are the first ones behind the gap, they join it
+  MoveGap(first);
+  gap_size_ += last - first;
+  if (gap_size_ < count) {
+    GrowGap(count);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    size_t slot = gap_begin_ + i;
+    types_[slot] = replacement.Type(i);
+    offsets_[slot] = replacement.Offset(i);
+    lengths_[slot] = replacement.Length(i);
+    value_ids_[slot] = IsTokenNumber(replacement.Type(i)) ? AddConstant(replacement.Number(i)) : replacement.ValueId(i);
+  }
+  gap_begin_ += count;
+  gap_size_ -= count;
+  tail_base_ = static_cast<uint32_t>(tail_base_ + shift);
+}
+
+void TokenBuffer::MoveGap(size_t position) {
+  if (gap_begin_ == kNoGap) {
+    gap_begin_ = types_.size();
+    gap_size_ = 0;
+    tail_base_ = 0;
+  }
+  // Tokens that cross the gap are copied as blocks, then switch between
+  // absolute offsets and offsets relative to tail_base_.
+  auto move = [&](size_t from, size_t to, size_t count) {
+    auto block = [&](auto& array) {
+      std::memmove(array.data() + to, array.data() + from, count * sizeof(array[0]));
+    };
+    block(types_);
+    block(offsets_);
+    block(lengths_);
+    block(value_ids_);
+  };
+  if (position < gap_begin_) {
+    size_t count = gap_begin_ - position;
+    move(position, position + gap_size_, count);
+    for (size_t i = position + gap_size_; i < gap_begin_ + gap_size_; ++i) {
+      offsets_[i] -= tail_base_;
+    }
+  } else if (position > gap_begin_) {
+    size_t count = position - gap_begin_;
+    move(gap_begin_ + gap_size_, gap_begin_, count);
+    for (size_t i = gap_begin_; i < position; ++i) {
+      offsets_[i] += tail_base_;
+    }
+  }
+  gap_begin_ = position;
+}
+
+void TokenBuffer::GrowGap(size_t count) {
+  // grow in proportion to the buffer so a run of insertions stays amortized
+  size_t extra = std::max(count - gap_size_, types_.size() / 16 + 64);
+  size_t tail = gap_begin_ + gap_size_;
+  auto grow = [&](auto& array) {
+    array.resize(array.size() + extra);
+    std::move_backward(array.begin() + tail, array.end() - extra, array.end());
+  };
+  grow(types_);
+  grow(offsets_);
+  grow(lengths_);
+  grow(value_ids_);
+  gap_size_ += extra;
+}
+
+void TokenBuffer::CloseGap() {
+  size_t size = Size();
+  MoveGap(size);
+  types_.resize(size);
+  offsets_.resize(size);
+  lengths_.resize(size);
+  value_ids_.resize(size);
+  gap_begin_ = kNoGap;
+  gap_size_ = 0;
+  tail_base_ = 0;
+}
+
+void TokenBuffer::Reserve(size_t count) {
+  types_.reserve(count + gap_size_);
+  offsets_.reserve(count + gap_size_);
+  lengths_.reserve(count + gap_size_);
+  value_ids_.reserve(count + gap_size_);
+}
@@ -0,0 +1,317 @@
+#include "token_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include "arena.h"
+#include "hash.h"
+#include "lexer.h"
+#include "mapped_file.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'O', 'N', 'O', 'T', 'O', 'K', '\0'};
+// bump whenever the layout or the meaning of the tokens changes
+constexpr uint32_t kVersion = 5;
+
+// Every section starts at a multiple of eight bytes after the header:
+// types, offsets, lengths, values, constants, string ends, string bytes,
+// line starts and errors. Values are string indices, or constant indices for
+// numbers; errors are an offset, the diagnostic id with the argument size in
+// the second byte, and the argument bytes.
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t token_count;
+  uint64_t source_hash;
+  uint64_t source_size;
+  uint32_t constant_count;
+  uint32_t string_count;
+  uint32_t string_bytes;
+  uint32_t line_count;
+  uint32_t error_count;
+  uint32_t reserved;
+};
+
+constexpr uint32_t kNoString = UINT32_MAX;
+
+size_t Align(size_t size) {
+  return (size + 7) & ~size_t{7};
+}
+
+struct Layout {
+  size_t types;
+  size_t offsets;
+  size_t lengths;
+  size_t values;
+  size_t constants;
+  size_t string_ends;
+  size_t strings;
+  size_t line_starts;
+  size_t errors;
+  size_t size;
+
+  explicit Layout(const Header& header) {
+    size_t tokens = header.token_count;
+    types = sizeof(Header);
+    offsets = types + Align(tokens);
+    lengths = offsets + Align(tokens * 4);
+    values = lengths + Align(tokens * 4);
+    constants = values + Align(tokens * 4);
+    string_ends = constants + size_t{header.constant_count} * 8;
+    strings = string_ends + Align(size_t{header.string_count} * 4);
+    line_starts = strings + Align(header.string_bytes);
+    errors = line_starts + Align(size_t{header.line_count} * 4);
+    size = errors + size_t{header.error_count} * 12;
+  }
+};
+
+// Decodes an error record, returns false if it is corrupt.
+bool ReadError(const char* fields, FileId file_id, ErrorData& error) {
+  uint32_t offset;
+  uint32_t id;
+  std::memcpy(&offset, fields, 4);
+  std::memcpy(&id, fields + 4, 4);
+  if ((id & 0xFF) >= DiagnosticIdCount || (id >> 8) > sizeof(error.arg)) {
+    return false;
+  }
+  error.location = {file_id, offset};
+  error.id = static_cast<DiagnosticId>(id & 0xFF);
+  error.arg_size = static_cast<uint8_t>(id >> 8);
+  std::memcpy(error.arg, fields + 8, sizeof(error.arg));
+  return true;
+}
+
+// Assigns the cache's own string indices, since symbols differ per process.
+class StringTable {
+public:
+  uint32_t Add(std::string_view str) {
+    auto [it, inserted] = indices_.try_emplace(str, static_cast<uint32_t>(ends_.size()));
+    if (inserted) {
+      bytes_.append(str);
+      ends_.push_back(static_cast<uint32_t>(bytes_.size()));
+    }
+    return it->second;
+  }
+
+  const std::vector<uint32_t>& Ends() const { return ends_; }
+  const std::string& Bytes() const { return bytes_; }
+
+private:
+  std::unordered_map<std::string_view, uint32_t> indices_;
+  std::vector<uint32_t> ends_;
+  std::string bytes_;
+};
+
+template <typename T>
+void Write(std::string& out, size_t at, const T* data, size_t count) {
+  if (count != 0) {
+    std::memcpy(out.data() + at, data, count * sizeof(T));
+  }
+}
+
+}  // namespace
+
+TokenCache::TokenCache(std::filesystem::path directory) : directory_(std::move(directory)) {
+}
+
+std::filesystem::path TokenCache::EntryPath(uint64_t source_hash) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.tok", static_cast<unsigned long long>(source_hash));
+  return directory_ / name;
+}
+
+void TokenCache::Tokenize(SourceManager& sources, FileId file_id, TokenBuffer& tokens, std::vector<ErrorData>& errors) {
+  if (!Load(sources, file_id, tokens, errors)) {
+    ErrorHandler lexer_errors{sources};
+    Arena arena;
+    Lexer lexer{sources, file_id, arena, lexer_errors};
+    tokens.Clear();
+    lexer.TokenizeAll(tokens);
+    errors = lexer_errors.Errors();
+    Store(sources, file_id, tokens, errors);
+  }
+}
+
+bool TokenCache::Load(SourceManager& sources, FileId file_id, TokenBuffer& tokens, std::vector<ErrorData>& errors) {
+  std::string_view source = sources.Buffer(file_id);
+  uint64_t source_hash = HashBytes(source);
+  MappedFile file;
+  Header header;
+  if (!file.Open(EntryPath(source_hash).string()) || file.Size() < sizeof(Header)) {
+    misses_++;
+    return false;
+  }
+  std::string_view data = file.Data();
+  std::memcpy(&header, data.data(), sizeof(Header));
+  Layout layout{header};
+  // a different hash means a collision in the file name
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+      header.source_hash != source_hash || header.source_size != source.size() || layout.size != data.size()) {
+    misses_++;
+    return false;
+  }
+  auto section = [&](size_t offset) { return data.data() + offset; };
+  auto read32 = [&](size_t offset, size_t i) {
+    uint32_t value;
+    std::memcpy(&value, section(offset) + i * 4, 4);
+    return value;
+  };
+
+  std::vector<std::string_view> strings(header.string_count);
+  uint32_t string_start = 0;
+  for (uint32_t i = 0; i < header.string_count; ++i) {
+    uint32_t string_end = read32(layout.string_ends, i);
+    if (string_end < string_start || string_end > header.string_bytes) {
+      misses_++;
+      return false;
+    }
+    strings[i] = {section(layout.strings) + string_start, string_end - string_start};
+    string_start = string_end;
+  }
+  // GetLineInfo trusts these, the first line starts at 0 and the rest follow
+  // in order inside the source
+  std::vector<uint32_t> line_starts(header.line_count);
+  std::memcpy(line_starts.data(), section(layout.line_starts), size_t{header.line_count} * 4);
+  bool lines_valid = !line_starts.empty() && line_starts[0] == 0;
+  for (size_t i = 1; lines_valid && i < line_starts.size(); ++i) {
+    lines_valid = line_starts[i] > line_starts[i - 1] && line_starts[i] <= source.size();
+  }
+  if (!lines_valid) {
+    misses_++;
+    return false;
+  }
+
+  // interned on first use
+  std::vector<Symbol> symbols;
+  symbols.assign(header.string_count, kNoSymbol);
+
+  tokens.Clear();
+  tokens.SetSource(file_id, source);
+  tokens.Reserve(header.token_count);
+  for (uint32_t i = 0; i < header.constant_count; ++i) {
+    TokenPayload payload;
+    std::memcpy(&payload.bits, section(layout.constants) + i * 8, 8);
+    tokens.AddConstant(payload);
+  }
+  for (uint32_t i = 0; i < header.token_count; ++i) {
+    auto type = static_cast<TokenType>(section(layout.types)[i]);
+    uint32_t offset = read32(layout.offsets, i);
+    uint32_t length = read32(layout.lengths, i);
+    uint32_t value = read32(layout.values, i);
+    bool valid = type < TokenTypeInvalid && uint64_t{offset} + length <= source.size();
+    if (IsTokenNumber(type)) {
+      valid = valid && value < header.constant_count;
+    } else if (value != kNoString) {
+      valid = valid && value < header.string_count;
+      if (valid) {
+        if (symbols[value] == kNoSymbol) {
+          symbols[value] = Interner::Global().Intern(strings[value]);
+        }
+        value = symbols[value];
+      }
+    } else {
+      value = kNoSymbol;
+    }
+    if (!valid) {
+      tokens.Clear();
+      misses_++;
+      return false;
+    }
+    tokens.Push(type, offset, length, value);
+  }
+
+  errors.clear();
+  for (uint32_t i = 0; i < header.error_count; ++i) {
+    ErrorData error;
+    if (!ReadError(section(layout.errors) + size_t{i} * 12, file_id, error)) {
+      tokens.Clear();
+      misses_++;
+      return false;
+    }
+    errors.push_back(error);
+  }
+
+  sources.SetLineStarts(file_id, std::move(line_starts));
+  hits_++;
+  return true;
+}
+
+bool TokenCache::Store(const SourceManager& sources, FileId file_id, const TokenBuffer& tokens,
+                       const std::vector<ErrorData>& errors) {
+  std::string_view source = sources.Buffer(file_id);
+  StringTable strings;
+  std::vector<uint8_t> types(tokens.Size());
+  std::vector<uint32_t> offsets(tokens.Size());
+  std::vector<uint32_t> lengths(tokens.Size());
+  std::vector<uint32_t> values(tokens.Size());
+  for (size_t i = 0; i < tokens.Size(); ++i) {
+    types[i] = tokens.Type(i);
+    offsets[i] = tokens.Offset(i);
+    lengths[i] = tokens.Length(i);
+    Symbol id = tokens.ValueId(i);
+    if (IsTokenNumber(tokens.Type(i))) {
+      values[i] = id;
+    } else {
+      values[i] = id == kNoSymbol ? kNoString : strings.Add(Interner::Global().Lookup(id));
+    }
+  }
+  std::vector<uint32_t> error_fields(errors.size() * 3);
+  for (size_t i = 0; i < errors.size(); ++i) {
+    const ErrorData& error = errors[i];
+    error_fields[i * 3] = error.location.offset;
+    error_fields[i * 3 + 1] = error.id | uint32_t{error.arg_size} << 8;
+    std::memcpy(&error_fields[i * 3 + 2], error.arg, sizeof(error.arg));
+  }
+  const std::vector<uint32_t>& line_starts = sources.LineStarts(file_id);
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.token_count = static_cast<uint32_t>(tokens.Size());
+  header.source_hash = HashBytes(source);
+  header.source_size = source.size();
+  header.constant_count = static_cast<uint32_t>(tokens.Constants().size());
+  header.string_count = static_cast<uint32_t>(strings.Ends().size());
+  header.string_bytes = static_cast<uint32_t>(strings.Bytes().size());
+  header.line_count = static_cast<uint32_t>(line_starts.size());
+  header.error_count = static_cast<uint32_t>(errors.size());
+  Layout layout{header};
+
+  std::string out(layout.size, '\0');
+  Write(out, 0, &header, 1);
+  Write(out, layout.types, types.data(), types.size());
+  Write(out, layout.offsets, offsets.data(), offsets.size());
+  Write(out, layout.lengths, lengths.data(), lengths.size());
+  Write(out, layout.values, values.data(), values.size());
+  Write(out, layout.constants, tokens.Constants().data(), tokens.Constants().size());
+  Write(out, layout.string_ends, strings.Ends().data(), strings.Ends().size());
+  Write(out, layout.strings, strings.Bytes().data(), strings.Bytes().size());
+  Write(out, layout.line_starts, line_starts.data(), line_starts.size());
+  Write(out, layout.errors, error_fields.data(), error_fields.size());
+
+  // write to a temporary file first so concurrent builds never read a
+  // partial entry
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  std::filesystem::path path = EntryPath(header.source_hash);
+  std::filesystem::path temporary = path;
+  temporary += ".tmp" + std::to_string(std::random_device{}());
+  // closing flushes, so a full disk can show up only there
+  std::ofstream stream(temporary, std::ios::binary);
+  stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+  stream.close();
+  if (!stream) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+# Token specification. tools/token_gen turns it into the minimized DFA the
+# lexer runs (generated/token_dfa.h).
+#
+# Every line is `<rule> <name> <pattern>`. A pattern is a sequence of "quoted
+# strings" and [character classes], each optionally followed by *, + or ?.
+# Classes take ranges, a leading ^ to negate, and the escapes \s (whitespace),
+# \n, \t, \r, \v, \f and \<char>. The lexer takes the longest match; on a tie
+# the rule listed first wins.
+#
+# operator and punctuation rules must be plain strings, their names become
+# OperatorId values. The comment, string and character rules only match the
+# opening delimiter, the lexer scans the rest. A token may look at most one
+# byte past its end, so every prefix of a longer token must be a token too.
+
+operator ShiftLeftAssign "<<="
+operator ShiftRightAssign ">>="
+operator Equal "=="
+operator NotEqual "!="
+operator LessEqual "<="
+operator GreaterEqual ">="
+operator LogicalAnd "&&"
+operator LogicalOr "||"
+operator ShiftLeft "<<"
+operator ShiftRight ">>"
+operator Arrow "->"
+operator Increment "++"
+operator Decrement "--"
+operator AddAssign "+="
+operator SubtractAssign "-="
+operator MultiplyAssign "*="
+operator DivideAssign "/="
+operator ModuloAssign "%="
+operator XorAssign "^="
+operator AndAssign "&="
+operator OrAssign "|="
+operator Assign "="
+operator Add "+"
+operator Subtract "-"
+operator Multiply "*"
+operator Divide "/"
+operator Modulo "%"
+operator Xor "^"
+operator Not "!"
+operator Less "<"
+operator Greater ">"
+operator And "&"
+operator Or "|"
+operator Complement "~"
+operator Question "?"
+
+punctuation LeftParen "("
+punctuation RightParen ")"
+punctuation LeftBrace "{"
+punctuation RightBrace "}"
+punctuation LeftBracket "["
+punctuation RightBracket "]"
+punctuation Comma ","
+punctuation Colon ":"
+punctuation Semicolon ";"
+punctuation Dot "."
+
+line_comment LineComment "//"
+block_comment BlockComment "/*"
+string String "\""
+character Character "'"
+
+# ' separates digit groups, f, F, l and L are type suffixes; the lexer works
+# out the type and reports malformed numbers.
+number Number [0-9][0-9'.fFlL]*
+
+# Anything else up to the next whitespace, operator or punctuation is an
+# identifier or keyword; the lexer reports the ones with invalid characters.
+identifier Identifier [^\s0-9"'=+\-*/%^!<>&|~?(){}\[\],:;.][^\s=+\-*/%^!<>&|~?(){}\[\],:;.]*
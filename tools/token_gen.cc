@@ -0,0 +1,616 @@
+// Builds the lexer's DFA from tokens.spec: the patterns are compiled to an NFA,
+// turned into a DFA by subset construction and minimized, and the transition
+// table is written out as a header over byte equivalence classes.
+//
+// usage: token_gen <tokens.spec> <token_dfa.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using CharSet = std::bitset<256>;
+
+// Rule kinds the lexer knows about, in the order of the generated TokenRule
+// enum.
+const std::vector<std::pair<std::string_view, std::string_view>> kRuleKinds = {
+    {"operator", "Operator"},
+    {"punctuation", "Punctuation"},
+    {"number", "Number"},
+    {"identifier", "Identifier"},
+    {"line_comment", "LineComment"},
+    {"block_comment", "BlockComment"},
+    {"string", "String"},
+    {"character", "Character"},
+};
+
+struct Rule {
+  int line;
+  // index into kRuleKinds
+  int kind;
+  std::string name;
+  // set for operator and punctuation rules
+  std::string spelling;
+  int operator_id = 0;
+};
+
+struct NfaState {
+  CharSet chars;
+  // target of the chars edge
+  int next = -1;
+  std::vector<int> epsilon;
+  // index of the rule matched when this state is reached, or -1
+  int accept = -1;
+};
+
+struct Fragment {
+  int start;
+  int end;
+};
+
+class Nfa {
+public:
+  int AddState() {
+    states_.emplace_back();
+    return static_cast<int>(states_.size() - 1);
+  }
+
+  NfaState& operator[](int state) {
+    return states_[state];
+  }
+
+  const NfaState& operator[](int state) const {
+    return states_[state];
+  }
+
+  Fragment Chars(const CharSet& chars) {
+    int start = AddState();
+    int end = AddState();
+    states_[start].chars = chars;
+    states_[start].next = end;
+    return {start, end};
+  }
+
+  Fragment Concat(Fragment a, Fragment b) {
+    states_[a.end].epsilon.push_back(b.start);
+    return {a.start, b.end};
+  }
+
+  Fragment Repeat(Fragment f, char quantifier) {
+    int start = AddState();
+    int end = AddState();
+    states_[start].epsilon.push_back(f.start);
+    states_[f.end].epsilon.push_back(end);
+    if (quantifier != '+') {
+      states_[start].epsilon.push_back(end);
+    }
+    if (quantifier != '?') {
+      states_[f.end].epsilon.push_back(f.start);
+    }
+    return {start, end};
+  }
+
+  // Adds the states reachable through epsilon edges.
+  void Closure(std::vector<int>& set) const {
+    std::vector<int> stack = set;
+    std::vector<bool> seen(states_.size());
+    for (int state : set) {
+      seen[state] = true;
+    }
+    while (!stack.empty()) {
+      int state = stack.back();
+      stack.pop_back();
+      for (int next : states_[state].epsilon) {
+        if (!seen[next]) {
+          seen[next] = true;
+          set.push_back(next);
+          stack.push_back(next);
+        }
+      }
+    }
+    std::sort(set.begin(), set.end());
+  }
+private:
+  std::vector<NfaState> states_;
+};
+
+struct Dfa {
+  // state 0 is the dead state, 1 the start state
+  std::vector<std::vector<int>> transitions;
+  // rule accepted in each state, or -1
+  std::vector<int> accept;
+};
+
+const char* spec_path = "";
+
+[[noreturn]] void Fail(int line, const std::string& message) {
+  std::cerr << spec_path << ":" << line << ": " << message << std::endl;
+  std::exit(1);
+}
+
+class PatternParser {
+public:
+  PatternParser(std::string_view text, int line, Nfa& nfa) : text_(text), line_(line), nfa_(nfa) {}
+
+  Fragment Parse() {
+    int start = nfa_.AddState();
+    Fragment result{start, start};
+    SkipSpaces();
+    if (pos_ == text_.size()) {
+      Fail(line_, "missing pattern");
+    }
+    while (pos_ < text_.size()) {
+      Fragment element = ParseElement();
+      if (pos_ < text_.size() && (text_[pos_] == '*' || text_[pos_] == '+' || text_[pos_] == '?')) {
+        element = nfa_.Repeat(element, text_[pos_++]);
+      }
+      result = nfa_.Concat(result, element);
+      SkipSpaces();
+    }
+    return result;
+  }
+
+  // Returns the text of a pattern that is a single quoted string, or an empty
+  // string.
+  static std::string Spelling(std::string_view text, int line) {
+    Nfa scratch;
+    PatternParser parser(text, line, scratch);
+    parser.SkipSpaces();
+    if (parser.pos_ == text.size() || text[parser.pos_] != '"') {
+      return {};
+    }
+    std::string spelling = parser.ParseString();
+    parser.SkipSpaces();
+    return parser.pos_ == text.size() ? spelling : std::string();
+  }
+private:
+  void SkipSpaces() {
+    while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) {
+      pos_++;
+    }
+  }
+
+  Fragment ParseElement() {
+    char c = text_[pos_];
+    if (c == '"') {
+      std::string string = ParseString();
+      if (string.empty()) {
+        Fail(line_, "empty string in pattern");
+      }
+      int start = nfa_.AddState();
+      Fragment result{start, start};
+      for (char s : string) {
+        CharSet chars;
+        chars.set(static_cast<unsigned char>(s));
+        result = nfa_.Concat(result, nfa_.Chars(chars));
+      }
+      return result;
+    }
+    if (c == '[') {
+      return nfa_.Chars(ParseClass());
+    }
+    Fail(line_, std::string("unexpected '") + c + "' in pattern");
+  }
+
+  std::string ParseString() {
+    pos_++;
+    std::string result;
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (text_[pos_] == '\\') {
+        pos_++;
+        if (pos_ == text_.size()) {
+          break;
+        }
+      }
+      result += text_[pos_++];
+    }
+    if (pos_ == text_.size()) {
+      Fail(line_, "unterminated string in pattern");
+    }
+    pos_++;
+    return result;
+  }
+
+  // Reads one character of a class, resolving escapes. \s stands for the
+  // whitespace set and is returned through whitespace.
+  int ParseClassChar(bool& whitespace) {
+    whitespace = false;
+    char c = text_[pos_++];
+    if (c != '\\') {
+      return static_cast<unsigned char>(c);
+    }
+    if (pos_ == text_.size()) {
+      Fail(line_, "unterminated escape in character class");
+    }
+    c = text_[pos_++];
+    switch (c) {
+      case 's':
+        whitespace = true;
+        return -1;
+      case 'n':
+        return '\n';
+      case 't':
+        return '\t';
+      case 'r':
+        return '\r';
+      case 'v':
+        return '\v';
+      case 'f':
+        return '\f';
+      default:
+        return static_cast<unsigned char>(c);
+    }
+  }
+
+  CharSet ParseClass() {
+    pos_++;
+    bool negate = pos_ < text_.size() && text_[pos_] == '^';
+    if (negate) {
+      pos_++;
+    }
+    CharSet chars;
+    while (pos_ < text_.size() && text_[pos_] != ']') {
+      bool whitespace;
+      int first = ParseClassChar(whitespace);
+      if (whitespace) {
+        for (char s : std::string_view(" \t\n\r\v\f")) {
+          chars.set(static_cast<unsigned char>(s));
+        }
+        continue;
+      }
+      int last = first;
+      if (pos_ + 1 < text_.size() && text_[pos_] == '-' && text_[pos_ + 1] != ']') {
+        pos_++;
+        last = ParseClassChar(whitespace);
+        if (whitespace || last < first) {
+          Fail(line_, "invalid range in character class");
+        }
+      }
+      for (int i = first; i <= last; ++i) {
+        chars.set(i);
+      }
+    }
+    if (pos_ == text_.size()) {
+      Fail(line_, "unterminated character class");
+    }
+    pos_++;
+    return negate ? ~chars : chars;
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+  int line_;
+  Nfa& nfa_;
+};
+
+std::vector<Rule> ParseSpec(std::istream& in, Nfa& nfa, int start) {
+  std::vector<Rule> rules;
+  std::set<std::string> names;
+  int operator_count = 0;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    std::istringstream fields(line);
+    std::string kind;
+    std::string name;
+    if (!(fields >> kind) || kind[0] == '#') {
+      continue;
+    }
+    if (!(fields >> name)) {
+      Fail(line_number, "missing rule name");
+    }
+    auto found = std::find_if(kRuleKinds.begin(), kRuleKinds.end(), [&](const auto& k) { return k.first == kind; });
+    if (found == kRuleKinds.end()) {
+      Fail(line_number, "unknown rule '" + kind + "'");
+    }
+    if (!names.insert(name).second) {
+      Fail(line_number, "duplicate rule name '" + name + "'");
+    }
+    std::string pattern;
+    std::getline(fields, pattern);
+
+    Rule rule{.line = line_number,
+              .kind = static_cast<int>(found - kRuleKinds.begin()),
+              .name = name,
+              .spelling = {},
+              .operator_id = 0};
+    if (found->first == "operator" || found->first == "punctuation") {
+      rule.spelling = PatternParser::Spelling(pattern, line_number);
+      if (rule.spelling.empty()) {
+        Fail(line_number, "operator and punctuation patterns must be a single string");
+      }
+      rule.operator_id = ++operator_count;
+    }
+    Fragment fragment = PatternParser(pattern, line_number, nfa).Parse();
+    nfa[fragment.end].accept = static_cast<int>(rules.size());
+    nfa[start].epsilon.push_back(fragment.start);
+    rules.push_back(rule);
+  }
+  return rules;
+}
+
+Dfa BuildDfa(const Nfa& nfa, int start) {
+  Dfa dfa;
+  std::map<std::vector<int>, int> ids;
+  std::vector<std::vector<int>> sets;
+  auto add = [&](std::vector<int> set) {
+    auto [it, inserted] = ids.emplace(set, static_cast<int>(sets.size()));
+    if (inserted) {
+      int accept = -1;
+      for (int state : set) {
+        if (nfa[state].accept != -1 && (accept == -1 || nfa[state].accept < accept)) {
+          accept = nfa[state].accept;
+        }
+      }
+      sets.push_back(std::move(set));
+      dfa.accept.push_back(accept);
+      dfa.transitions.emplace_back(256, 0);
+    }
+    return it->second;
+  };
+  add({});
+  std::vector<int> initial{start};
+  nfa.Closure(initial);
+  add(initial);
+  for (size_t i = 1; i < sets.size(); ++i) {
+    for (int c = 0; c < 256; ++c) {
+      std::vector<int> next;
+      for (int state : sets[i]) {
+        if (nfa[state].next != -1 && nfa[state].chars.test(c)) {
+          next.push_back(nfa[state].next);
+        }
+      }
+      nfa.Closure(next);
+      next.erase(std::unique(next.begin(), next.end()), next.end());
+      int id = add(std::move(next));
+      dfa.transitions[i][c] = id;
+    }
+  }
+  return dfa;
+}
+
+// Moore's partition refinement. States start out grouped by the rule they
+// accept and are split until all states of a group move to the same groups.
+Dfa Minimize(const Dfa& dfa) {
+  size_t count = dfa.transitions.size();
+  std::vector<int> group(count);
+  for (size_t i = 0; i < count; ++i) {
+    group[i] = dfa.accept[i] + 1;
+  }
+  size_t group_count = 0;
+  while (true) {
+    std::map<std::vector<int>, int> signatures;
+    std::vector<int> next(count);
+    // the dead and start states are looked up first so they keep ids 0 and 1
+    for (size_t i = 0; i < count; ++i) {
+      std::vector<int> signature{group[i]};
+      for (int target : dfa.transitions[i]) {
+        signature.push_back(group[target]);
+      }
+      next[i] = signatures.emplace(signature, static_cast<int>(signatures.size())).first->second;
+    }
+    group = std::move(next);
+    if (signatures.size() == group_count) {
+      break;
+    }
+    group_count = signatures.size();
+  }
+
+  Dfa minimal;
+  minimal.transitions.assign(group_count, std::vector<int>(256, 0));
+  minimal.accept.assign(group_count, -1);
+  for (size_t i = 0; i < count; ++i) {
+    for (int c = 0; c < 256; ++c) {
+      minimal.transitions[group[i]][c] = group[dfa.transitions[i][c]];
+    }
+    minimal.accept[group[i]] = dfa.accept[i];
+  }
+  return minimal;
+}
+
+void Check(const Dfa& dfa, const std::vector<Rule>& rules) {
+  if (dfa.accept[1] != -1) {
+    Fail(rules[dfa.accept[1]].line, "rule '" + rules[dfa.accept[1]].name + "' matches the empty string");
+  }
+  std::vector<bool> reachable(rules.size());
+  for (size_t state = 0; state < dfa.transitions.size(); ++state) {
+    int accept = dfa.accept[state];
+    if (accept == -1) {
+      continue;
+    }
+    reachable[accept] = true;
+    for (int target : dfa.transitions[state]) {
+      if (target != 0 && dfa.accept[target] == -1) {
+        Fail(rules[accept].line,
+                        "rule '" + rules[accept].name + "' is a prefix of a token that needs more lookahead");
+      }
+    }
+  }
+  for (size_t i = 0; i < rules.size(); ++i) {
+    if (!reachable[i]) {
+      Fail(rules[i].line, "rule '" + rules[i].name + "' never matches");
+    }
+  }
+  if (dfa.transitions.size() > UINT16_MAX) {
+    Fail(0, "too many DFA states");
+  }
+}
+
+std::string Escape(std::string_view text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+void WriteHeader(std::ostream& out, const Dfa& dfa, const std::vector<Rule>& rules) {
+  // bytes that move every state to the same state share a column
+  std::vector<int> byte_classes(256);
+  std::map<std::vector<int>, int> columns;
+  for (int c = 0; c < 256; ++c) {
+    std::vector<int> column;
+    for (const auto& row : dfa.transitions) {
+      column.push_back(row[c]);
+    }
+    byte_classes[c] = columns.emplace(column, static_cast<int>(columns.size())).first->second;
+  }
+  std::vector<int> class_bytes(columns.size());
+  for (int c = 255; c >= 0; --c) {
+    class_bytes[byte_classes[c]] = c;
+  }
+  const char* state_type = dfa.transitions.size() <= UINT8_MAX ? "uint8_t" : "uint16_t";
+
+  out << "// Generated by token_gen from tokens.spec. Do not edit.\n"
+         "\n"
+         "#pragma once\n"
+         "\n"
+         "#include <cstdint>\n"
+         "#include <string_view>\n"
+         "\n"
+         "enum TokenRule : uint8_t {\n"
+         "  TokenRuleNone,\n";
+  for (const auto& kind : kRuleKinds) {
+    out << "  TokenRule" << kind.second << ",\n";
+  }
+  out << "};\n"
+         "\n"
+         "// Operators and punctuation.\n"
+         "enum OperatorId : uint8_t {\n"
+         "  OperatorIdNone,\n";
+  for (const Rule& rule : rules) {
+    if (rule.operator_id != 0) {
+      out << "  OperatorId" << rule.name << ",\n";
+    }
+  }
+  out << "  OperatorIdCount\n"
+         "};\n"
+         "\n"
+         "constexpr std::string_view kOperatorNames[] = {\n"
+         "    \"\",\n";
+  for (const Rule& rule : rules) {
+    if (rule.operator_id != 0) {
+      out << "    \"" << Escape(rule.spelling) << "\",\n";
+    }
+  }
+  out << "};\n"
+         "\n"
+         "using DfaState = "
+      << state_type
+      << ";\n"
+         "\n"
+         "constexpr DfaState kDfaDead = 0;\n"
+         "constexpr DfaState kDfaStart = 1;\n"
+         "constexpr int kDfaStateCount = "
+      << dfa.transitions.size()
+      << ";\n"
+         "constexpr int kDfaClassCount = "
+      << columns.size()
+      << ";\n"
+         "\n"
+         "constexpr uint8_t kDfaByteClasses[256] = {";
+  for (int c = 0; c < 256; ++c) {
+    out << (c % 16 == 0 ? "\n    " : " ") << byte_classes[c] << ",";
+  }
+  out << "\n};\n"
+         "\n"
+         "constexpr DfaState kDfaTransitions[kDfaStateCount][kDfaClassCount] = {\n";
+  for (const auto& row : dfa.transitions) {
+    out << "    {";
+    for (size_t i = 0; i < class_bytes.size(); ++i) {
+      out << (i == 0 ? "" : ", ") << row[class_bytes[i]];
+    }
+    out << "},\n";
+  }
+  out << "};\n"
+         "\n"
+         "constexpr TokenRule kDfaAcceptRules[kDfaStateCount] = {\n";
+  for (int accept : dfa.accept) {
+    out << "    "
+        << (accept == -1 ? std::string("TokenRuleNone")
+                         : "TokenRule" + std::string(kRuleKinds[rules[accept].kind].second))
+        << ",\n";
+  }
+  out << "};\n"
+         "\n"
+         "constexpr OperatorId kDfaAcceptOperators[kDfaStateCount] = {\n";
+  for (int accept : dfa.accept) {
+    out << "    "
+        << (accept == -1 || rules[accept].operator_id == 0 ? std::string("OperatorIdNone")
+                                                           : "OperatorId" + rules[accept].name)
+        << ",\n";
+  }
+  out << "};\n"
+         "\n"
+         "struct TokenMatch {\n"
+         "  const char* end;\n"
+         "  TokenRule rule;\n"
+         "  OperatorId op;\n"
+         "};\n"
+         "\n"
+         "// Runs the DFA from p and returns the longest token there. rule is\n"
+         "// TokenRuleNone and end is p if no token starts at p.\n"
+         "inline TokenMatch MatchToken(const char* p, const char* end) {\n"
+         "  TokenMatch match{p, TokenRuleNone, OperatorIdNone};\n"
+         "  DfaState state = kDfaStart;\n"
+         "  while (p != end) {\n"
+         "    state = kDfaTransitions[state][kDfaByteClasses[static_cast<unsigned char>(*p++)]];\n"
+         "    if (state == kDfaDead) {\n"
+         "      break;\n"
+         "    }\n"
+         "    if (kDfaAcceptRules[state] != TokenRuleNone) {\n"
+         "      match = {p, kDfaAcceptRules[state], kDfaAcceptOperators[state]};\n"
+         "    }\n"
+         "  }\n"
+         "  return match;\n"
+         "}\n"
+         "\n"
+         "// Returns the operator or punctuation spelled exactly like text, or\n"
+         "// OperatorIdNone.\n"
+         "inline OperatorId LookupOperator(std::string_view text) {\n"
+         "  TokenMatch match = MatchToken(text.data(), text.data() + text.size());\n"
+         "  return match.end == text.data() + text.size() ? match.op : OperatorIdNone;\n"
+         "}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "usage: token_gen <tokens.spec> <token_dfa.h>" << std::endl;
+    return 1;
+  }
+  std::ifstream in(argv[1]);
+  if (!in) {
+    std::cerr << argv[1] << ": cannot open" << std::endl;
+    return 1;
+  }
+  spec_path = argv[1];
+  Nfa nfa;
+  int start = nfa.AddState();
+  std::vector<Rule> rules = ParseSpec(in, nfa, start);
+  Dfa dfa = Minimize(BuildDfa(nfa, start));
+  Check(dfa, rules);
+
+  std::ofstream out(argv[2]);
+  WriteHeader(out, dfa, rules);
+  if (!out) {
+    std::cerr << argv[2] << ": cannot write" << std::endl;
+    return 1;
+  }
+  return 0;
+}